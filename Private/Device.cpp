@@ -17,6 +17,13 @@ CBuffer::Ref CDeviceBase<TDerived>::CreateBuffer(size_t size, EBufferUsageFlags
     return static_cast<TDerived*>(this)->CreateBuffer(size, usage, initialData);
 }
 
+template <typename TDerived>
+CTransientAllocation CDeviceBase<TDerived>::AllocateTransient(size_t size,
+                                                              EBufferUsageFlags usage)
+{
+    return static_cast<TDerived*>(this)->AllocateTransient(size, usage);
+}
+
 template <typename TDerived>
 CImage::Ref CDeviceBase<TDerived>::CreateImage1D(EFormat format, EImageUsageFlags usage,
                                                  uint32_t width, uint32_t mipLevels,
@@ -54,6 +61,33 @@ CImageView::Ref CDeviceBase<TDerived>::CreateImageView(const CImageViewDesc& des
     return static_cast<TDerived*>(this)->CreateImageView(desc, image);
 }
 
+template <typename TDerived>
+CImage::Ref CDeviceBase<TDerived>::CreateImageFromFile(const std::string& path,
+                                                       EImageUsageFlags usage)
+{
+    return static_cast<TDerived*>(this)->CreateImageFromFile(path, usage);
+}
+
+template <typename TDerived> uint64_t CDeviceBase<TDerived>::FlushUploads()
+{
+    return static_cast<TDerived*>(this)->FlushUploads();
+}
+
+template <typename TDerived> bool CDeviceBase<TDerived>::IsUploadComplete(uint64_t token)
+{
+    return static_cast<TDerived*>(this)->IsUploadComplete(token);
+}
+
+template <typename TDerived> void CDeviceBase<TDerived>::WaitForUpload(uint64_t token)
+{
+    static_cast<TDerived*>(this)->WaitForUpload(token);
+}
+
+template <typename TDerived> CUploadStats CDeviceBase<TDerived>::GetUploadStats() const
+{
+    return static_cast<const TDerived*>(this)->GetUploadStats();
+}
+
 template <typename TDerived>
 CShaderModule::Ref CDeviceBase<TDerived>::CreateShaderModule(size_t size, const void* pCode)
 {
@@ -62,16 +96,23 @@ CShaderModule::Ref CDeviceBase<TDerived>::CreateShaderModule(size_t size, const
 
 template <typename TDerived>
 CDescriptorSetLayout::Ref CDeviceBase<TDerived>::CreateDescriptorSetLayout(
-    const std::vector<CDescriptorSetLayoutBinding>& bindings)
+    const std::vector<CDescriptorSetLayoutBinding>& bindings, bool bPushDescriptors)
 {
-    return static_cast<TDerived*>(this)->CreateDescriptorSetLayout(bindings);
+    return static_cast<TDerived*>(this)->CreateDescriptorSetLayout(bindings, bPushDescriptors);
 }
 
 template <typename TDerived>
 CPipelineLayout::Ref CDeviceBase<TDerived>::CreatePipelineLayout(
-    const std::vector<CDescriptorSetLayout::Ref>& setLayouts)
+    const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+    const std::vector<CPushConstantRange>& pushConstantRanges)
+{
+    return static_cast<TDerived*>(this)->CreatePipelineLayout(setLayouts, pushConstantRanges);
+}
+
+template <typename TDerived>
+CBindlessHeap::Ref CDeviceBase<TDerived>::GetBindlessHeap()
 {
-    return static_cast<TDerived*>(this)->CreatePipelineLayout(setLayouts);
+    return static_cast<TDerived*>(this)->GetBindlessHeap();
 }
 
 template <typename TDerived>
@@ -116,6 +157,40 @@ template <typename TDerived> CCommandQueue::Ref CDeviceBase<TDerived>::CreateCom
     return static_cast<TDerived*>(this)->CreateCommandQueue();
 }
 
+template <typename TDerived>
+CCommandQueue::Ref CDeviceBase<TDerived>::CreateCommandQueue(EQueueType queueType)
+{
+    return static_cast<TDerived*>(this)->CreateCommandQueue(queueType);
+}
+
+template <typename TDerived>
+CQueueCaps CDeviceBase<TDerived>::GetQueueCaps(EQueueType queueType) const
+{
+    return static_cast<const TDerived*>(this)->GetQueueCaps(queueType);
+}
+
+template <typename TDerived> CDescriptorStats CDeviceBase<TDerived>::GetDescriptorStats() const
+{
+    return static_cast<const TDerived*>(this)->GetDescriptorStats();
+}
+
+template <typename TDerived>
+CConstantMemoryStats CDeviceBase<TDerived>::GetConstantMemoryStats() const
+{
+    return static_cast<const TDerived*>(this)->GetConstantMemoryStats();
+}
+
+template <typename TDerived> CMemoryStats CDeviceBase<TDerived>::GetMemoryStats() const
+{
+    return static_cast<const TDerived*>(this)->GetMemoryStats();
+}
+
+template <typename TDerived>
+CDefragmentStats CDeviceBase<TDerived>::Defragment(const CDefragmentOptions& options)
+{
+    return static_cast<TDerived*>(this)->Defragment(options);
+}
+
 template <typename TDerived>
 CSwapChain::Ref CDeviceBase<TDerived>::CreateSwapChain(const CPresentationSurfaceDesc& info,
                                                        EFormat format)
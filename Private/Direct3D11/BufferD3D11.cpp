@@ -60,4 +60,9 @@ void* CBufferD3D11::Map(size_t offset, size_t size)
 
 void CBufferD3D11::Unmap() { ImmediateContext->Unmap(BufferPtr.Get(), 0); }
 
+// The immediate context makes mapped memory coherent, nothing outlives Unmap here
+void CBufferD3D11::FlushRange(size_t offset, size_t size) {}
+
+void CBufferD3D11::InvalidateRange(size_t offset, size_t size) {}
+
 } /* namespace RHI */
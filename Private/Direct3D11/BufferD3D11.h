@@ -15,6 +15,8 @@ public:
 
     void* Map(size_t offset, size_t size);
     void Unmap();
+    void FlushRange(size_t offset, size_t size);
+    void InvalidateRange(size_t offset, size_t size);
 
     ID3D11Buffer* GetD3D11Buffer() const { return BufferPtr.Get(); }
 
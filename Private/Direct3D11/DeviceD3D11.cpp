@@ -34,9 +34,9 @@ CNativeDevice GetNativeDevice(CDevice* device)
 void InitRHIInstance() {}
 void ShutdownRHIInstance() {}
 
-CDeviceD3D11::CDeviceD3D11(EDeviceCreateHints hints)
+CDeviceD3D11::CDeviceD3D11(EDeviceCreateHints hints, const CDeviceCreateOptions& options)
 {
-    // Doesn't respect the hints yet
+    // Doesn't respect the hints or the options yet
 
     HRESULT hr = S_OK;
 
@@ -13,7 +13,7 @@ class CShaderCacheD3D11;
 class CDeviceD3D11 : public CDeviceBase<CDeviceD3D11>
 {
 public:
-    CDeviceD3D11(EDeviceCreateHints hints);
+    CDeviceD3D11(EDeviceCreateHints hints, const CDeviceCreateOptions& options);
     ~CDeviceD3D11();
 
     // Resources and resource views
@@ -1,6 +1,7 @@
 #include "ManagedPipeline.h"
 #include "Device.h"
 #include <StringPrintf.h>
+#include <algorithm>
 
 namespace RHI
 {
@@ -29,6 +30,8 @@ CManagedPipeline::CManagedPipeline(CDevice& device, CComputePipelineDesc& desc)
 
 CDescriptorSet::Ref CManagedPipeline::CreateDescriptorSet(uint32_t set) const
 {
+    if (BindlessHeap && SetLayouts[set] == BindlessHeap->GetLayout())
+        return BindlessHeap->GetDescriptorSet();
     return SetLayouts[set]->CreateDescriptorSet();
 }
 
@@ -36,10 +39,10 @@ std::vector<CDescriptorSet::Ref> CManagedPipeline::CreateDescriptorSets() const
 {
     std::vector<CDescriptorSet::Ref> result;
     result.reserve(SetLayouts.size());
-    for (const auto& layout : SetLayouts)
+    for (uint32_t set = 0; set < SetLayouts.size(); set++)
     {
-        if (layout)
-            result.push_back(layout->CreateDescriptorSet());
+        if (SetLayouts[set])
+            result.push_back(CreateDescriptorSet(set));
     }
     return result;
 }
@@ -57,6 +60,54 @@ void CManagedPipeline::InitLayouts(CDevice& device)
         { EPipelineResourceType::StorageBuffer, EDescriptorType::StorageBuffer },
     };
 
+    // Uniform buffers are made dynamic so BindConstants only has to move an offset. The spec only
+    //   guarantees 8 of them per pipeline layout, the rest stay regular uniform buffers
+    const uint32_t maxDynamicUniformBuffers = 8;
+    uint32_t dynamicUniformBuffers = 0;
+
+    // Ask for push descriptors if the per-draw set is this small. The same set and bindings get
+    //   the same layout in every pipeline, so sets stay interchangeable between them
+    const uint32_t maxPushDescriptors = 8;
+    auto isPushed = [&](uint32_t set, const std::vector<CDescriptorSetLayoutBinding>& b) {
+        if (set != PushDescriptorSet)
+            return false;
+        uint32_t count = 0;
+        for (const auto& x : b)
+        {
+            if (x.Count == 0)
+                return false;
+            count += x.Count;
+        }
+        return count <= maxPushDescriptors;
+    };
+
+    // A set with unbounded arrays has to be exactly the bindless heap's layout to be compatible
+    auto createSetLayout = [&](uint32_t set, const std::vector<CDescriptorSetLayoutBinding>& b,
+                               bool bPushDescriptors) {
+        SetLayouts.resize(set + 1);
+        bool bIsUnbounded = std::any_of(
+            b.begin(), b.end(), [](const CDescriptorSetLayoutBinding& x) { return x.Count == 0; });
+        if (!bIsUnbounded)
+        {
+            SetLayouts[set] = device.CreateDescriptorSetLayout(b, bPushDescriptors);
+            return;
+        }
+
+        static const std::map<uint32_t, EDescriptorType> heapTypes = {
+            { CBindlessHeap::ImageBinding, EDescriptorType::Image },
+            { CBindlessHeap::StorageBufferBinding, EDescriptorType::StorageBuffer },
+            { CBindlessHeap::SamplerBinding, EDescriptorType::Sampler },
+        };
+        for (const auto& x : b)
+        {
+            auto iter = heapTypes.find(x.Binding);
+            if (iter == heapTypes.end() || iter->second != x.Type || x.Count != 0)
+                throw CRHIRuntimeError("Sets with unbounded arrays must match the bindless heap");
+        }
+        BindlessHeap = device.GetBindlessHeap();
+        SetLayouts[set] = BindlessHeap->GetLayout();
+    };
+
     // Some nonsense number that surely has no meaning
     uint32_t currSet = 0xF0F0F0F0;
     std::vector<CDescriptorSetLayoutBinding> bindings;
@@ -65,10 +116,7 @@ void CManagedPipeline::InitLayouts(CDevice& device)
         if (pair.first.first != currSet)
         {
             if (currSet != 0xF0F0F0F0 && !bindings.empty())
-            {
-                SetLayouts.resize(currSet + 1);
-                SetLayouts[currSet] = device.CreateDescriptorSetLayout(bindings);
-            }
+                createSetLayout(currSet, bindings, isPushed(currSet, bindings));
 
             bindings.clear();
             currSet = pair.first.first;
@@ -83,13 +131,16 @@ void CManagedPipeline::InitLayouts(CDevice& device)
         binding.Type = typeMap.at(pair.second.ResourceType);
         binding.StageFlags = pair.second.Stages;
         binding.Count = pair.second.ArraySize;
+        if (binding.Type == EDescriptorType::UniformBuffer
+            && dynamicUniformBuffers + binding.Count <= maxDynamicUniformBuffers)
+        {
+            binding.Type = EDescriptorType::UniformBufferDynamic;
+            dynamicUniformBuffers += binding.Count;
+        }
         bindings.emplace_back(binding);
     }
     if (!bindings.empty())
-    {
-        SetLayouts.resize(currSet + 1);
-        SetLayouts[currSet] = device.CreateDescriptorSetLayout(bindings);
-    }
+        createSetLayout(currSet, bindings, isPushed(currSet, bindings));
 
     for (auto& layout : SetLayouts)
     {
@@ -98,7 +149,10 @@ void CManagedPipeline::InitLayouts(CDevice& device)
             layout = device.CreateDescriptorSetLayout({});
         }
     }
-    PipelineLayout = device.CreatePipelineLayout(SetLayouts);
+    if (PushConstants.Size > 0)
+        PipelineLayout = device.CreatePipelineLayout(SetLayouts, { PushConstants });
+    else
+        PipelineLayout = device.CreatePipelineLayout(SetLayouts);
 
     ResourceByBinding.clear();
 }
@@ -111,6 +165,27 @@ void CManagedPipeline::ReflectShaderModule(const CShaderModule::Ref& shaderModul
     // Grab all resources from each individual shader and put them into a big hash map
     for (const auto& resource : shaderModule->GetShaderResources())
     {
+        // Push constants don't have a set or binding, grow the one shared range instead
+        if (resource.ResourceType == EPipelineResourceType::PushConstantBuffer)
+        {
+            // The declared struct size already runs from byte 0 to the end of the last member
+            uint32_t end = resource.Size;
+            if (PushConstants.Size == 0)
+            {
+                PushConstants.StageFlags = resource.Stages;
+                PushConstants.Offset = resource.Offset;
+                PushConstants.Size = end - resource.Offset;
+            }
+            else
+            {
+                end = std::max(end, PushConstants.Offset + PushConstants.Size);
+                PushConstants.StageFlags |= resource.Stages;
+                PushConstants.Offset = std::min(PushConstants.Offset, resource.Offset);
+                PushConstants.Size = end - PushConstants.Offset;
+            }
+            continue;
+        }
+
         auto key = std::make_pair(resource.Set, resource.Binding);
 
         // We dont care about stage inputs and outputs
@@ -16,6 +16,8 @@ public:
 
     void* Map(size_t offset, size_t size);
     void Unmap();
+    void FlushRange(size_t offset, size_t size);
+    void InvalidateRange(size_t offset, size_t size);
 
     id GetMTLBuffer() const { return Buffer; }
 
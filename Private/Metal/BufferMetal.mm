@@ -79,4 +79,16 @@ void CBufferMetal::Unmap()
     MappedSize = 0;
 }
 
+void CBufferMetal::FlushRange(size_t offset, size_t size)
+{
+    id<MTLBuffer> buf = (id<MTLBuffer>)Buffer;
+    if (buf.storageMode == MTLStorageModeManaged)
+    {
+        [buf didModifyRange:NSMakeRange(offset, size)];
+    }
+}
+
+// Host visible buffers are all created shared, which the CPU and GPU see coherently
+void CBufferMetal::InvalidateRange(size_t offset, size_t size) {}
+
 } /* namespace RHI */
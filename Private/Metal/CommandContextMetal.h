@@ -3,10 +3,28 @@
 #include "CopyContext.h"
 #include "ComputeContext.h"
 #include "RenderContext.h"
+#include <array>
 
 namespace RHI
 {
 
+// Polls the command buffer holding the copy, Metal reports completion per command buffer
+class CReadbackMetal : public CReadback
+{
+public:
+    CReadbackMetal(id commandBuffer, CBuffer::Ref buffer, size_t size);
+
+    bool IsReady() override;
+    void Wait() override;
+    const void* GetData() override;
+    size_t GetSize() const override { return Size; }
+
+private:
+    id CommandBuffer;
+    CBuffer::Ref Buffer;
+    size_t Size;
+};
+
 class CCommandContextMetal : public ICopyContext,
                              public IComputeContext,
                              public IRenderContext,
@@ -35,10 +53,13 @@ public:
                    EFilter filter) override;
     void ResolveImage(CImage& src, CImage& dst,
                       const std::vector<CImageResolve>& regions) override;
+    CReadback::Ref ReadbackBuffer(CBuffer& src, size_t offset, size_t size) override;
+    CReadback::Ref ReadbackImage(CImage& src, const CBufferImageCopy& region) override;
 
     // IComputeContext
     void BindComputePipeline(CPipeline& pipeline) override;
     void BindComputeDescriptorSet(uint32_t set, CDescriptorSet& descriptorSet) override;
+    void PushConstants(uint32_t offset, uint32_t size, const void* data) override;
     void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
     void DispatchIndirect(CBuffer& buffer, size_t offset) override;
 
@@ -59,6 +80,7 @@ public:
                       uint32_t stride) override;
     void DrawIndexedIndirect(CBuffer& buffer, size_t offset, uint32_t drawCount,
                              uint32_t stride) override;
+    void SubmitDrawBatch(const CDrawRecord* records, size_t count) override;
 
     void FinishRecording() override;
 
@@ -79,6 +101,8 @@ private:
     EContextMode Mode;
     CDeviceMetal& Device;
 
+    // Set for copy and compute contexts
+    id CommandBuffer = nil;
     id BlitEncoder = nil;
     id ComputeEncoder = nil;
     id RenderEncoder = nil;
@@ -88,6 +112,10 @@ private:
     id BoundIndexBuffer = nil;
     size_t BoundIndexOffset = 0;
     MTLIndexType BoundIndexType = MTLIndexTypeUInt32;
+
+    // Shadow copy of the push constant block, re-sent with setBytes on every change
+    std::array<uint8_t, 256> PushConstantData {};
+    uint32_t PushConstantSize = 0;
 };
 
 class CRenderPassContextMetal : public IParallelRenderContext
@@ -100,6 +128,7 @@ public:
     ~CRenderPassContextMetal() override;
 
     IRenderContext::Ref CreateRenderContext(uint32_t subpass) override;
+    void ExecuteBundle(uint32_t subpass, CRenderBundle::Ref bundle) override;
     void FinishRecording() override;
 
 private:
@@ -24,6 +24,7 @@ CCommandContextMetal::Ref CCommandContextMetal::CreateCopyContext(CCommandListMe
 {
     auto ctx = Ref(new CCommandContextMetal(EContextMode::Copy,
                                             cmdList.GetQueue().GetDevice()));
+    ctx->CommandBuffer = cmdList.GetMTLCommandBuffer();
     ctx->BlitEncoder = [(id<MTLCommandBuffer>)cmdList.GetMTLCommandBuffer() blitCommandEncoder];
     return ctx;
 }
@@ -32,6 +33,7 @@ CCommandContextMetal::Ref CCommandContextMetal::CreateComputeContext(CCommandLis
 {
     auto ctx = Ref(new CCommandContextMetal(EContextMode::Compute,
                                             cmdList.GetQueue().GetDevice()));
+    ctx->CommandBuffer = cmdList.GetMTLCommandBuffer();
     ctx->ComputeEncoder = [(id<MTLCommandBuffer>)cmdList.GetMTLCommandBuffer() computeCommandEncoder];
     return ctx;
 }
@@ -102,12 +104,14 @@ void CCommandContextMetal::CopyBufferToImage(CBuffer& src, CImage& dst,
 
     for (const auto& region : regions)
     {
-        NSUInteger bytesPerRow = region.BufferRowLength > 0
-            ? region.BufferRowLength
-            : region.ImageExtent.Width * 4;
-        NSUInteger bytesPerImage = region.BufferImageHeight > 0
-            ? bytesPerRow * region.BufferImageHeight
-            : bytesPerRow * region.ImageExtent.Height;
+        // Row length and image height are in texels like Vulkan, 0 meaning tightly packed
+        CFormatInfo info = GetFormatInfo(dstImg.GetFormat());
+        uint32_t rowLength =
+            region.BufferRowLength > 0 ? region.BufferRowLength : region.ImageExtent.Width;
+        uint32_t imageHeight =
+            region.BufferImageHeight > 0 ? region.BufferImageHeight : region.ImageExtent.Height;
+        NSUInteger bytesPerRow = info.GetRowPitch(rowLength);
+        NSUInteger bytesPerImage = info.GetSliceSize(rowLength, imageHeight);
 
         [BlitEncoder copyFromBuffer:srcBuf.GetMTLBuffer()
                        sourceOffset:region.BufferOffset
@@ -132,12 +136,14 @@ void CCommandContextMetal::CopyImageToBuffer(CImage& src, CBuffer& dst,
 
     for (const auto& region : regions)
     {
-        NSUInteger bytesPerRow = region.BufferRowLength > 0
-            ? region.BufferRowLength
-            : region.ImageExtent.Width * 4;
-        NSUInteger bytesPerImage = region.BufferImageHeight > 0
-            ? bytesPerRow * region.BufferImageHeight
-            : bytesPerRow * region.ImageExtent.Height;
+        // Row length and image height are in texels like Vulkan, 0 meaning tightly packed
+        CFormatInfo info = GetFormatInfo(srcImg.GetFormat());
+        uint32_t rowLength =
+            region.BufferRowLength > 0 ? region.BufferRowLength : region.ImageExtent.Width;
+        uint32_t imageHeight =
+            region.BufferImageHeight > 0 ? region.BufferImageHeight : region.ImageExtent.Height;
+        NSUInteger bytesPerRow = info.GetRowPitch(rowLength);
+        NSUInteger bytesPerImage = info.GetSliceSize(rowLength, imageHeight);
 
         [BlitEncoder copyFromTexture:srcImg.GetMTLTexture()
                          sourceSlice:region.ImageSubresource.BaseArrayLayer
@@ -192,6 +198,36 @@ void CCommandContextMetal::ResolveImage(CImage& src, CImage& dst,
     // Placeholder implementation
 }
 
+CReadback::Ref CCommandContextMetal::ReadbackBuffer(CBuffer& src, size_t offset, size_t size)
+{
+    if (!BlitEncoder)
+        throw CRHIRuntimeError("Readbacks have to be recorded in a copy context on Metal");
+    // No pool, shared buffers are cheap to make here
+    auto buffer = Device.CreateBuffer(size, EBufferUsageFlags::Readback);
+    CopyBuffer(src, *buffer, { { offset, 0, size } });
+    return std::make_shared<CReadbackMetal>(CommandBuffer, std::move(buffer), size);
+}
+
+CReadback::Ref CCommandContextMetal::ReadbackImage(CImage& src, const CBufferImageCopy& region)
+{
+    if (!BlitEncoder)
+        throw CRHIRuntimeError("Readbacks have to be recorded in a copy context on Metal");
+
+    CFormatInfo info = GetFormatInfo(static_cast<CImageMetal&>(src).GetFormat());
+    uint32_t rowLength =
+        region.BufferRowLength > 0 ? region.BufferRowLength : region.ImageExtent.Width;
+    uint32_t imageHeight =
+        region.BufferImageHeight > 0 ? region.BufferImageHeight : region.ImageExtent.Height;
+    size_t size = info.GetSliceSize(rowLength, imageHeight) * region.ImageExtent.Depth
+        * region.ImageSubresource.LayerCount;
+    auto buffer = Device.CreateBuffer(size, EBufferUsageFlags::Readback);
+
+    CBufferImageCopy atStart = region;
+    atStart.BufferOffset = 0;
+    CopyImageToBuffer(src, *buffer, { atStart });
+    return std::make_shared<CReadbackMetal>(CommandBuffer, std::move(buffer), size);
+}
+
 // --- IComputeContext ---
 
 void CCommandContextMetal::BindComputePipeline(CPipeline& pipeline)
@@ -209,6 +245,36 @@ void CCommandContextMetal::BindComputeDescriptorSet(uint32_t set,
     ds.ApplyToComputeEncoder(ComputeEncoder, BoundComputePipeline->GetCSRemap(), set);
 }
 
+void CCommandContextMetal::PushConstants(uint32_t offset, uint32_t size, const void* data)
+{
+    if (offset + size > PushConstantData.size())
+        throw CRHIRuntimeError("Push constants exceed 256 bytes");
+    memcpy(PushConstantData.data() + offset, data, size);
+    PushConstantSize = std::max(PushConstantSize, offset + size);
+
+    if (Mode == EContextMode::Compute && BoundComputePipeline)
+    {
+        uint32_t index = BoundComputePipeline->GetCSRemap().PushConstantBuffer;
+        if (index != ~0U)
+            [ComputeEncoder setBytes:PushConstantData.data()
+                              length:PushConstantSize
+                             atIndex:index];
+    }
+    else if (Mode == EContextMode::Render && BoundRenderPipeline)
+    {
+        uint32_t vsIndex = BoundRenderPipeline->GetVSRemap().PushConstantBuffer;
+        uint32_t psIndex = BoundRenderPipeline->GetPSRemap().PushConstantBuffer;
+        if (vsIndex != ~0U)
+            [RenderEncoder setVertexBytes:PushConstantData.data()
+                                   length:PushConstantSize
+                                  atIndex:vsIndex];
+        if (psIndex != ~0U)
+            [RenderEncoder setFragmentBytes:PushConstantData.data()
+                                     length:PushConstantSize
+                                    atIndex:psIndex];
+    }
+}
+
 void CCommandContextMetal::Dispatch(uint32_t groupCountX, uint32_t groupCountY,
                                     uint32_t groupCountZ)
 {
@@ -386,6 +452,48 @@ void CCommandContextMetal::DrawIndexedIndirect(CBuffer& buffer, size_t offset,
     }
 }
 
+void CCommandContextMetal::SubmitDrawBatch(const CDrawRecord* records, size_t count)
+{
+    // Qualified calls so the compiler can skip the vtable
+    CDescriptorSet* boundSets[CDrawRecord::MaxDescriptorSets] = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        const CDrawRecord& record = records[i];
+
+        if (record.Pipeline && record.Pipeline != BoundRenderPipeline)
+        {
+            CCommandContextMetal::BindRenderPipeline(*record.Pipeline);
+            // Bindings are remapped per pipeline
+            for (auto& boundSet : boundSets)
+                boundSet = nullptr;
+        }
+        for (uint32_t set = 0; set < CDrawRecord::MaxDescriptorSets; set++)
+        {
+            if (record.DescriptorSets[set] && record.DescriptorSets[set] != boundSets[set])
+            {
+                boundSets[set] = record.DescriptorSets[set];
+                CCommandContextMetal::BindRenderDescriptorSet(set, *boundSets[set]);
+            }
+        }
+        for (uint32_t binding = 0; binding < CDrawRecord::MaxVertexBuffers; binding++)
+        {
+            if (record.VertexBuffers[binding])
+                CCommandContextMetal::BindVertexBuffer(binding, *record.VertexBuffers[binding],
+                                                       record.VertexOffsets[binding]);
+        }
+        if (record.IndexBuffer)
+            CCommandContextMetal::BindIndexBuffer(*record.IndexBuffer, record.IndexOffset,
+                                                  record.IndexFormat);
+
+        if (record.bIndexed)
+            CCommandContextMetal::DrawIndexed(record.Count, record.InstanceCount, record.First,
+                                              record.VertexOffset, record.FirstInstance);
+        else
+            CCommandContextMetal::Draw(record.Count, record.InstanceCount, record.First,
+                                       record.FirstInstance);
+    }
+}
+
 void CCommandContextMetal::FinishRecording()
 {
     if (BlitEncoder)
@@ -452,6 +560,12 @@ IRenderContext::Ref CRenderPassContextMetal::CreateRenderContext(uint32_t subpas
     return CCommandContextMetal::CreateRenderContext(encoder, CmdList.GetQueue().GetDevice());
 }
 
+void CRenderPassContextMetal::ExecuteBundle(uint32_t subpass, CRenderBundle::Ref bundle)
+{
+    // Would map to MTLIndirectCommandBuffer, which can't express all of IRenderContext yet
+    throw CRHIRuntimeError("Render bundles are not supported on Metal");
+}
+
 void CRenderPassContextMetal::FinishRecording()
 {
     if (ParallelEncoder)
@@ -461,4 +575,33 @@ void CRenderPassContextMetal::FinishRecording()
     }
 }
 
+// --- CReadbackMetal ---
+
+CReadbackMetal::CReadbackMetal(id commandBuffer, CBuffer::Ref buffer, size_t size)
+    : CommandBuffer(commandBuffer)
+    , Buffer(std::move(buffer))
+    , Size(size)
+{
+}
+
+bool CReadbackMetal::IsReady()
+{
+    return [(id<MTLCommandBuffer>)CommandBuffer status] == MTLCommandBufferStatusCompleted;
+}
+
+void CReadbackMetal::Wait()
+{
+    id<MTLCommandBuffer> cmdBuf = (id<MTLCommandBuffer>)CommandBuffer;
+    if (cmdBuf.status < MTLCommandBufferStatusCommitted)
+        throw CRHIRuntimeError("Waited on a readback whose command list wasn't submitted");
+    [cmdBuf waitUntilCompleted];
+}
+
+const void* CReadbackMetal::GetData()
+{
+    if (!IsReady())
+        return nullptr;
+    return [(id<MTLBuffer>)static_cast<CBufferMetal&>(*Buffer).GetMTLBuffer() contents];
+}
+
 } /* namespace RHI */
@@ -17,6 +17,7 @@ public:
 
     void Enqueue() override;
     void Commit() override;
+    void WaitFor(CCommandList::Ref other) override;
 
     ICopyContext::Ref CreateCopyContext() override;
     IComputeContext::Ref CreateComputeContext() override;
@@ -29,6 +30,9 @@ public:
 private:
     CCommandQueueMetal& Queue;
     id CommandBuffer;
+    bool bIsCommitted = false;
+    // Events other lists wait on, encoded when we commit
+    std::vector<id> SignalEvents;
 };
 
 } /* namespace RHI */
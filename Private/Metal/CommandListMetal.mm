@@ -1,6 +1,7 @@
 #include "CommandListMetal.h"
 #include "CommandContextMetal.h"
 #include "CommandQueueMetal.h"
+#include "DeviceMetal.h"
 #include "RHIException.h"
 #include "RenderPassMetal.h"
 
@@ -24,7 +25,28 @@ void CCommandListMetal::Enqueue()
 
 void CCommandListMetal::Commit()
 {
+    for (id event : SignalEvents)
+        [(id<MTLCommandBuffer>)CommandBuffer encodeSignalEvent:(id<MTLEvent>)event value:1];
+    SignalEvents.clear();
+
     Queue.EnqueuePendingBuffer(CommandBuffer);
+    bIsCommitted = true;
+}
+
+void CCommandListMetal::WaitFor(CCommandList::Ref other)
+{
+    auto otherImpl = std::static_pointer_cast<CCommandListMetal>(other);
+    if (otherImpl.get() == this)
+        throw CRHIRuntimeError("A command list can't wait for itself");
+    if (&otherImpl->GetQueue() == &Queue)
+        throw CRHIRuntimeError("Lists on the same queue already execute in enqueue order");
+    if (bIsCommitted || otherImpl->bIsCommitted)
+        throw CRHIRuntimeError("Dependencies must be declared before either list is committed");
+
+    // Waits are encoded in place, so this has to happen before any encoder is created
+    id<MTLEvent> event = [(id<MTLDevice>)Queue.GetDevice().GetMTLDevice() newEvent];
+    [(id<MTLCommandBuffer>)CommandBuffer encodeWaitForEvent:event value:1];
+    otherImpl->SignalEvents.push_back(event);
 }
 
 ICopyContext::Ref CCommandListMetal::CreateCopyContext()
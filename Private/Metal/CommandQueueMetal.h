@@ -18,6 +18,7 @@ public:
     ~CCommandQueueMetal() override;
 
     CCommandList::Ref CreateCommandList() override;
+    CRenderBundle::Ref CreateRenderBundle(CRenderPass::Ref renderPass, uint32_t subpass) override;
     void Flush() override;
     void Finish() override;
 
@@ -23,6 +23,12 @@ CCommandList::Ref CCommandQueueMetal::CreateCommandList()
     return std::make_shared<CCommandListMetal>(*this);
 }
 
+CRenderBundle::Ref CCommandQueueMetal::CreateRenderBundle(CRenderPass::Ref renderPass,
+                                                          uint32_t subpass)
+{
+    throw CRHIRuntimeError("Render bundles are not supported on Metal");
+}
+
 void CCommandQueueMetal::EnqueuePendingBuffer(id cmdBuf)
 {
     PendingCommandBuffers.push_back(cmdBuf);
@@ -10,11 +10,12 @@ class CDeviceMetal : public CDevice
 public:
     typedef std::shared_ptr<CDeviceMetal> Ref;
 
-    explicit CDeviceMetal(EDeviceCreateHints hints);
+    CDeviceMetal(EDeviceCreateHints hints, const CDeviceCreateOptions& options);
     ~CDeviceMetal() override;
 
     CBuffer::Ref CreateBuffer(size_t size, EBufferUsageFlags usage,
                               const void* initialData = nullptr);
+    CTransientAllocation AllocateTransient(size_t size, EBufferUsageFlags usage);
     CImage::Ref CreateImage1D(EFormat format, EImageUsageFlags usage, uint32_t width,
                               uint32_t mipLevels = 1, uint32_t arrayLayers = 1,
                               uint32_t sampleCount = 1, const void* initialData = nullptr);
@@ -25,13 +26,21 @@ public:
                               uint32_t height, uint32_t depth, uint32_t mipLevels = 1,
                               uint32_t arrayLayers = 1, uint32_t sampleCount = 1,
                               const void* initialData = nullptr);
+    CImage::Ref CreateImageFromFile(const std::string& path, EImageUsageFlags usage);
     CImageView::Ref CreateImageView(const CImageViewDesc& desc, CImage::Ref image);
+    // Initial data is written synchronously, there is never anything pending
+    uint64_t FlushUploads() { return 0; }
+    bool IsUploadComplete(uint64_t token) { return true; }
+    void WaitForUpload(uint64_t token) {}
+    CUploadStats GetUploadStats() const { return {}; }
 
     CShaderModule::Ref CreateShaderModule(size_t size, const void* pCode);
     CDescriptorSetLayout::Ref
-    CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings);
+    CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings,
+                              bool bPushDescriptors = false);
     CPipelineLayout::Ref
-    CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts);
+    CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+                         const std::vector<CPushConstantRange>& pushConstantRanges = {});
 
     CRenderPass::Ref CreateRenderPass(const CRenderPassDesc& desc);
     CPipeline::Ref CreatePipeline(const CPipelineDesc& desc);
@@ -39,6 +48,13 @@ public:
     CSampler::Ref CreateSampler(const CSamplerDesc& desc);
 
     CCommandQueue::Ref CreateCommandQueue();
+    CCommandQueue::Ref CreateCommandQueue(EQueueType queueType);
+    CQueueCaps GetQueueCaps(EQueueType queueType) const;
+    CDescriptorStats GetDescriptorStats() const;
+    CConstantMemoryStats GetConstantMemoryStats() const;
+    CMemoryStats GetMemoryStats() const;
+    CDefragmentStats Defragment(const CDefragmentOptions& options);
+    CBindlessHeap::Ref GetBindlessHeap();
     CSwapChain::Ref CreateSwapChain(const CPresentationSurfaceDesc& info, EFormat format);
     void WaitIdle();
 
@@ -20,7 +20,8 @@ void InitRHIInstance() { }
 
 void ShutdownRHIInstance() { }
 
-CDeviceMetal::CDeviceMetal(EDeviceCreateHints hints)
+// Constants are copied into the command encoder, so none of the options apply
+CDeviceMetal::CDeviceMetal(EDeviceCreateHints hints, const CDeviceCreateOptions&)
 {
     NSArray<id<MTLDevice>>* devices = MTLCopyAllDevices();
     if (devices.count == 0)
@@ -54,6 +55,15 @@ CBuffer::Ref CDeviceMetal::CreateBuffer(size_t size, EBufferUsageFlags usage,
     return std::make_shared<CBufferMetal>(*this, size, usage, initialData);
 }
 
+// No ring here yet, a shared buffer per allocation is correct if not fast
+CTransientAllocation CDeviceMetal::AllocateTransient(size_t size, EBufferUsageFlags usage)
+{
+    CTransientAllocation result;
+    result.Buffer = CreateBuffer(size, usage | EBufferUsageFlags::Dynamic);
+    result.Data = result.Buffer->Map(0, size);
+    return result;
+}
+
 CImage::Ref CDeviceMetal::InternalCreateImage(unsigned long type, EFormat format,
                                               EImageUsageFlags usage, uint32_t width,
                                               uint32_t height, uint32_t depth, uint32_t mipLevels,
@@ -99,6 +109,11 @@ CImage::Ref CDeviceMetal::CreateImage3D(EFormat format, EImageUsageFlags usage,
                                arrayLayers, sampleCount, initialData);
 }
 
+CImage::Ref CDeviceMetal::CreateImageFromFile(const std::string& path, EImageUsageFlags usage)
+{
+    throw CRHIRuntimeError("Loading images from files is not supported on Metal");
+}
+
 CImageView::Ref CDeviceMetal::CreateImageView(const CImageViewDesc& desc, CImage::Ref image)
 {
     return std::make_shared<CImageViewMetal>(desc, image);
@@ -110,14 +125,18 @@ CShaderModule::Ref CDeviceMetal::CreateShaderModule(size_t size, const void* pCo
 }
 
 CDescriptorSetLayout::Ref
-CDeviceMetal::CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings)
+CDeviceMetal::CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings,
+                                        bool bPushDescriptors)
 {
+    // Metal binds arguments directly, there is nothing to push
     return std::make_shared<CDescriptorSetLayoutMetal>(*this, bindings);
 }
 
 CPipelineLayout::Ref
-CDeviceMetal::CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts)
+CDeviceMetal::CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+                                   const std::vector<CPushConstantRange>& pushConstantRanges)
 {
+    // Push constants become setBytes calls, nothing to declare up front
     return std::make_shared<CPipelineLayoutMetal>(setLayouts);
 }
 
@@ -146,6 +165,56 @@ CCommandQueue::Ref CDeviceMetal::CreateCommandQueue()
     return std::make_shared<CCommandQueueMetal>(*this);
 }
 
+CCommandQueue::Ref CDeviceMetal::CreateCommandQueue(EQueueType queueType)
+{
+    // Metal queues are all general purpose, the driver schedules them
+    return std::make_shared<CCommandQueueMetal>(*this);
+}
+
+CQueueCaps CDeviceMetal::GetQueueCaps(EQueueType queueType) const
+{
+    CQueueCaps caps;
+    caps.HardwareQueueCount = 1;
+    caps.bIsDedicated = queueType == EQueueType::Render;
+    caps.bSupportsRender = true;
+    caps.bSupportsCompute = true;
+    caps.bSupportsCopy = true;
+    return caps;
+}
+
+// No descriptor sets to count on Metal
+CDescriptorStats CDeviceMetal::GetDescriptorStats() const { return {}; }
+
+CConstantMemoryStats CDeviceMetal::GetConstantMemoryStats() const { return {}; }
+
+// Metal only reports the device as a whole, as one heap without categories
+CMemoryStats CDeviceMetal::GetMemoryStats() const
+{
+    id<MTLDevice> device = (id<MTLDevice>)Device;
+    CMemoryHeapStats heap;
+    heap.bDeviceLocal = true;
+    heap.Size = device.recommendedMaxWorkingSetSize;
+    heap.Budget = heap.Size;
+    heap.Usage = device.currentAllocatedSize;
+    heap.BlockBytes = heap.Usage;
+    heap.AllocatedBytes = heap.Usage;
+
+    CMemoryStats stats;
+    stats.Heaps.push_back(heap);
+    return stats;
+}
+
+CDefragmentStats CDeviceMetal::Defragment(const CDefragmentOptions& options)
+{
+    // Metal places resources itself, there is nothing we could move
+    return CDefragmentStats();
+}
+
+CBindlessHeap::Ref CDeviceMetal::GetBindlessHeap()
+{
+    throw CRHIRuntimeError("Bindless heap is not supported on Metal");
+}
+
 CSwapChain::Ref CDeviceMetal::CreateSwapChain(const CPresentationSurfaceDesc& info, EFormat format)
 {
     return std::make_shared<CSwapChainMetal>(*this, info, format);
@@ -62,19 +62,8 @@ CMemoryImageMetal::CMemoryImageMetal(CDeviceMetal& parent, unsigned long type, E
 
     if (initialData && texType == MTLTextureType2D && mipLevels == 1)
     {
-        NSUInteger bytesPerPixel = 4;
-        MTLPixelFormat pf = MtlCast(format);
-        if (pf == MTLPixelFormatR8Unorm || pf == MTLPixelFormatR8Uint || pf == MTLPixelFormatR8Sint)
-            bytesPerPixel = 1;
-        else if (pf == MTLPixelFormatRG8Unorm || pf == MTLPixelFormatR16Float)
-            bytesPerPixel = 2;
-        else if (pf == MTLPixelFormatRGBA16Float)
-            bytesPerPixel = 8;
-        else if (pf == MTLPixelFormatRGBA32Float)
-            bytesPerPixel = 16;
-
-        NSUInteger bytesPerRow = width * bytesPerPixel;
-        NSUInteger totalBytes = bytesPerRow * height;
+        NSUInteger bytesPerRow = GetFormatInfo(format).GetRowPitch(width);
+        NSUInteger totalBytes = GetFormatInfo(format).GetSliceSize(width, height);
 
         if (isStaging || desc.storageMode == MTLStorageModeShared)
         {
@@ -14,6 +14,8 @@ struct CMSLBindingRemap
     std::map<std::pair<uint32_t, uint32_t>, uint32_t> BufferBindings;
     std::map<std::pair<uint32_t, uint32_t>, uint32_t> TextureBindings;
     std::map<std::pair<uint32_t, uint32_t>, uint32_t> SamplerBindings;
+    // Buffer index of the push constant block, or ~0U if the shader has none
+    uint32_t PushConstantBuffer = ~0U;
 };
 
 struct CMSLCompileResult
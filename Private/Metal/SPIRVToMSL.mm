@@ -172,6 +172,9 @@ CMSLCompileResult CompileSPIRVToMSL(const uint32_t* spirvCode, size_t wordCount)
     extractRemap(shaderResources.sampled_images, false, true, true);
     extractRemap(shaderResources.subpass_inputs, false, true, false);
 
+    for (auto& res : shaderResources.push_constant_buffers)
+        result.Remap.PushConstantBuffer = compiler.get_automatic_msl_resource_binding(res.id);
+
     return result;
 }
 
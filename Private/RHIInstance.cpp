@@ -25,9 +25,10 @@ CDevice::Ref CInstance::GetCurrDevice() const { return CurrDevice; }
 
 void CInstance::SetCurrDevice(CDevice::Ref device) { CurrDevice = device; }
 
-CDevice::Ref CInstance::CreateDevice(EDeviceCreateHints hints)
+CDevice::Ref CInstance::CreateDevice(EDeviceCreateHints hints,
+                                     const CDeviceCreateOptions& options)
 {
-    return std::make_shared<TChooseImpl<CDeviceBase>::TDerived>(hints);
+    return std::make_shared<TChooseImpl<CDeviceBase>::TDerived>(hints, options);
 }
 
 CInstance::CInstance() { InitRHIInstance(); }
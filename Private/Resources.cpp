@@ -27,6 +27,17 @@ template <typename TDerived> void CBufferBase<TDerived>::Unmap()
     return static_cast<TDerived*>(this)->Unmap();
 }
 
+template <typename TDerived> void CBufferBase<TDerived>::FlushRange(size_t offset, size_t size)
+{
+    static_cast<TDerived*>(this)->FlushRange(offset, size);
+}
+
+template <typename TDerived>
+void CBufferBase<TDerived>::InvalidateRange(size_t offset, size_t size)
+{
+    static_cast<TDerived*>(this)->InvalidateRange(offset, size);
+}
+
 // Explicitly instanciate the wrapper for the chosen implementation
 template class RHI_API CBufferBase<TChooseImpl<CBufferBase>::TDerived>;
 
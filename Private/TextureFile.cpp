@@ -0,0 +1,348 @@
+#include "TextureFile.h"
+#include "RHIException.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace RHI
+{
+
+namespace
+{
+
+template <typename T> T ReadAt(const uint8_t* data, size_t size, size_t offset)
+{
+    if (offset + sizeof(T) > size)
+        throw CRHIRuntimeError("Texture file is truncated");
+    T value;
+    memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+CFormatInfo GetUploadableFormatInfo(EFormat format)
+{
+    CFormatInfo info = GetFormatInfo(format);
+    if (info.BytesPerBlock == 0 || info.Aspect != EFormatAspect::Color)
+        throw CRHIRuntimeError("Unsupported texture file format");
+    return info;
+}
+
+EFormat FormatFromDXGI(uint32_t dxgiFormat)
+{
+    switch (dxgiFormat)
+    {
+    case 2:
+        return EFormat::R32G32B32A32_SFLOAT;
+    case 10:
+        return EFormat::R16G16B16A16_SFLOAT;
+    case 11:
+        return EFormat::R16G16B16A16_UNORM;
+    case 16:
+        return EFormat::R32G32_SFLOAT;
+    case 24:
+        return EFormat::A2B10G10R10_UNORM_PACK32;
+    case 26:
+        return EFormat::B10G11R11_UFLOAT_PACK32;
+    case 28:
+        return EFormat::R8G8B8A8_UNORM;
+    case 29:
+        return EFormat::R8G8B8A8_SRGB;
+    case 34:
+        return EFormat::R16G16_SFLOAT;
+    case 41:
+        return EFormat::R32_SFLOAT;
+    case 49:
+        return EFormat::R8G8_UNORM;
+    case 54:
+        return EFormat::R16_SFLOAT;
+    case 56:
+        return EFormat::R16_UNORM;
+    case 61:
+        return EFormat::R8_UNORM;
+    case 71:
+        return EFormat::BC1_RGBA_UNORM_BLOCK;
+    case 72:
+        return EFormat::BC1_RGBA_SRGB_BLOCK;
+    case 74:
+        return EFormat::BC2_UNORM_BLOCK;
+    case 75:
+        return EFormat::BC2_SRGB_BLOCK;
+    case 77:
+        return EFormat::BC3_UNORM_BLOCK;
+    case 78:
+        return EFormat::BC3_SRGB_BLOCK;
+    case 80:
+        return EFormat::BC4_UNORM_BLOCK;
+    case 81:
+        return EFormat::BC4_SNORM_BLOCK;
+    case 83:
+        return EFormat::BC5_UNORM_BLOCK;
+    case 84:
+        return EFormat::BC5_SNORM_BLOCK;
+    case 87:
+        return EFormat::B8G8R8A8_UNORM;
+    case 91:
+        return EFormat::B8G8R8A8_SRGB;
+    case 95:
+        return EFormat::BC6H_UFLOAT_BLOCK;
+    case 96:
+        return EFormat::BC6H_SFLOAT_BLOCK;
+    case 98:
+        return EFormat::BC7_UNORM_BLOCK;
+    case 99:
+        return EFormat::BC7_SRGB_BLOCK;
+    default:
+        throw CRHIRuntimeError("Unsupported DXGI format in DDS file");
+    }
+}
+
+constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+    return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) |
+        (uint32_t(uint8_t(d)) << 24);
+}
+
+} /* namespace */
+
+#ifdef _WIN32
+
+CMappedFile::CMappedFile(const std::string& path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw CRHIRuntimeError("Could not open " + path);
+    FileHandle = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        throw CRHIRuntimeError("Could not map " + path);
+    }
+    Size = static_cast<size_t>(size.QuadPart);
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data)
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        throw CRHIRuntimeError("Could not map " + path);
+    }
+    MappingHandle = mapping;
+    Data = static_cast<const uint8_t*>(data);
+}
+
+CMappedFile::~CMappedFile()
+{
+    UnmapViewOfFile(Data);
+    CloseHandle(MappingHandle);
+    CloseHandle(FileHandle);
+}
+
+#else
+
+CMappedFile::CMappedFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw CRHIRuntimeError("Could not open " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        throw CRHIRuntimeError("Could not map " + path);
+    }
+    Size = static_cast<size_t>(st.st_size);
+
+    // The mapping keeps its own reference to the file
+    void* data = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        throw CRHIRuntimeError("Could not map " + path);
+    madvise(data, Size, MADV_SEQUENTIAL);
+    Data = static_cast<const uint8_t*>(data);
+}
+
+CMappedFile::~CMappedFile() { munmap(const_cast<uint8_t*>(Data), Size); }
+
+#endif
+
+CTextureFile::CTextureFile(const std::string& path)
+    : File(path)
+{
+    static const uint8_t KTX2Identifier[] = { 0xAB, 'K',  'T',  'X',  ' ', '2',
+                                              '0',  0xBB, '\r', '\n', 0x1A, '\n' };
+    if (File.GetSize() >= sizeof(KTX2Identifier)
+        && memcmp(File.GetData(), KTX2Identifier, sizeof(KTX2Identifier)) == 0)
+        ParseKTX2();
+    else if (File.GetSize() >= 4 && memcmp(File.GetData(), "DDS ", 4) == 0)
+        ParseDDS();
+    else
+        throw CRHIRuntimeError(path + " is neither a KTX2 nor a DDS file");
+
+    for (const auto& sub : Subresources)
+        if (sub.Offset + sub.Size > File.GetSize() || sub.Offset + sub.Size < sub.Offset)
+            throw CRHIRuntimeError(path + " is truncated");
+}
+
+void CTextureFile::ParseKTX2()
+{
+    const uint8_t* data = File.GetData();
+    size_t size = File.GetSize();
+
+    // KTX2 formats are Vulkan formats, which EFormat mirrors
+    uint32_t vkFormat = ReadAt<uint32_t>(data, size, 12);
+    if (vkFormat == 0)
+        throw CRHIRuntimeError("KTX2 files without a Vulkan format are not supported");
+    if (ReadAt<uint32_t>(data, size, 44) != 0)
+        throw CRHIRuntimeError("Supercompressed KTX2 files are not supported");
+    Format = static_cast<EFormat>(vkFormat);
+    CFormatInfo info = GetUploadableFormatInfo(Format);
+
+    Width = ReadAt<uint32_t>(data, size, 20);
+    uint32_t height = ReadAt<uint32_t>(data, size, 24);
+    uint32_t depth = ReadAt<uint32_t>(data, size, 28);
+    uint32_t layerCount = std::max(ReadAt<uint32_t>(data, size, 32), 1u);
+    uint32_t faceCount = ReadAt<uint32_t>(data, size, 36);
+    uint32_t levelCount = ReadAt<uint32_t>(data, size, 40);
+    if (Width == 0 || (faceCount != 1 && faceCount != 6))
+        throw CRHIRuntimeError("Malformed KTX2 header");
+    if (levelCount == 0)
+        throw CRHIRuntimeError("KTX2 files that ask for generated mips are not supported");
+
+    Height = std::max(height, 1u);
+    Depth = std::max(depth, 1u);
+    Type = depth > 0 ? EImageType::Image3D
+                     : (height > 0 ? EImageType::Image2D : EImageType::Image1D);
+    MipLevels = levelCount;
+    ArrayLayers = layerCount * faceCount;
+    bIsCubeMap = faceCount == 6;
+
+    // Each level holds all layers and faces back to back, tightly packed since there's no
+    //   supercompression
+    constexpr size_t levelIndexOffset = 80;
+    for (uint32_t mip = 0; mip < levelCount; mip++)
+    {
+        size_t entry = levelIndexOffset + mip * 24;
+        size_t offset = static_cast<size_t>(ReadAt<uint64_t>(data, size, entry));
+        size_t length = static_cast<size_t>(ReadAt<uint64_t>(data, size, entry + 8));
+        size_t imageSize = info.GetMipSize(Width, Height, Depth, mip);
+        if (imageSize * ArrayLayers > length)
+            throw CRHIRuntimeError("KTX2 level is smaller than its images");
+
+        for (uint32_t layer = 0; layer < ArrayLayers; layer++)
+            Subresources.push_back({ mip, layer, offset + layer * imageSize, imageSize });
+    }
+}
+
+void CTextureFile::ParseDDS()
+{
+    const uint8_t* data = File.GetData();
+    size_t size = File.GetSize();
+
+    constexpr size_t headerOffset = 4;
+    if (ReadAt<uint32_t>(data, size, headerOffset) != 124)
+        throw CRHIRuntimeError("Malformed DDS header");
+    uint32_t height = ReadAt<uint32_t>(data, size, headerOffset + 8);
+    Width = ReadAt<uint32_t>(data, size, headerOffset + 12);
+    uint32_t depth = ReadAt<uint32_t>(data, size, headerOffset + 20);
+    MipLevels = std::max(ReadAt<uint32_t>(data, size, headerOffset + 24), 1u);
+    uint32_t pfFlags = ReadAt<uint32_t>(data, size, headerOffset + 76);
+    uint32_t fourCC = ReadAt<uint32_t>(data, size, headerOffset + 80);
+    uint32_t caps2 = ReadAt<uint32_t>(data, size, headerOffset + 108);
+    if (Width == 0)
+        throw CRHIRuntimeError("Malformed DDS header");
+
+    constexpr uint32_t DDPF_FOURCC = 0x4;
+    constexpr uint32_t DDPF_RGB = 0x40;
+    constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+    constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+
+    size_t dataOffset = headerOffset + 124;
+    uint32_t layerCount = 1;
+    bool bIsVolume = (caps2 & DDSCAPS2_VOLUME) != 0;
+    bIsCubeMap = (caps2 & DDSCAPS2_CUBEMAP) != 0;
+    Type = height > 1 || bIsCubeMap ? EImageType::Image2D : EImageType::Image1D;
+
+    if ((pfFlags & DDPF_FOURCC) && fourCC == MakeFourCC('D', 'X', '1', '0'))
+    {
+        Format = FormatFromDXGI(ReadAt<uint32_t>(data, size, dataOffset));
+        uint32_t dimension = ReadAt<uint32_t>(data, size, dataOffset + 4);
+        uint32_t miscFlag = ReadAt<uint32_t>(data, size, dataOffset + 8);
+        layerCount = std::max(ReadAt<uint32_t>(data, size, dataOffset + 12), 1u);
+        dataOffset += 20;
+
+        // D3D10_RESOURCE_DIMENSION_TEXTURE1D/2D/3D
+        if (dimension == 2)
+            Type = EImageType::Image1D;
+        else if (dimension == 3)
+            Type = EImageType::Image2D;
+        else if (dimension == 4)
+            Type = EImageType::Image3D;
+        bIsCubeMap = (miscFlag & 0x4) != 0;
+        bIsVolume = dimension == 4;
+    }
+    else if (pfFlags & DDPF_FOURCC)
+    {
+        if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+            Format = EFormat::BC1_RGBA_UNORM_BLOCK;
+        else if (fourCC == MakeFourCC('D', 'X', 'T', '3'))
+            Format = EFormat::BC2_UNORM_BLOCK;
+        else if (fourCC == MakeFourCC('D', 'X', 'T', '5'))
+            Format = EFormat::BC3_UNORM_BLOCK;
+        else if (fourCC == MakeFourCC('A', 'T', 'I', '1')
+                 || fourCC == MakeFourCC('B', 'C', '4', 'U'))
+            Format = EFormat::BC4_UNORM_BLOCK;
+        else if (fourCC == MakeFourCC('A', 'T', 'I', '2')
+                 || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+            Format = EFormat::BC5_UNORM_BLOCK;
+        else
+            throw CRHIRuntimeError("Unsupported DDS FourCC");
+    }
+    else if ((pfFlags & DDPF_RGB) && ReadAt<uint32_t>(data, size, headerOffset + 84) == 32)
+    {
+        uint32_t redMask = ReadAt<uint32_t>(data, size, headerOffset + 88);
+        if (redMask == 0xff)
+            Format = EFormat::R8G8B8A8_UNORM;
+        else if (redMask == 0xff0000)
+            Format = EFormat::B8G8R8A8_UNORM;
+        else
+            throw CRHIRuntimeError("Unsupported DDS pixel layout");
+    }
+    else
+        throw CRHIRuntimeError("Unsupported DDS pixel format");
+
+    CFormatInfo info = GetUploadableFormatInfo(Format);
+    Height = std::max(height, 1u);
+    Depth = bIsVolume ? std::max(depth, 1u) : 1;
+    if (bIsVolume)
+        Type = EImageType::Image3D;
+    ArrayLayers = layerCount * (bIsCubeMap ? 6 : 1);
+
+    // Unlike KTX2, DDS stores each layer's whole mip chain before the next layer
+    size_t offset = dataOffset;
+    for (uint32_t layer = 0; layer < ArrayLayers; layer++)
+    {
+        for (uint32_t mip = 0; mip < MipLevels; mip++)
+        {
+            size_t mipSize = info.GetMipSize(Width, Height, Depth, mip);
+            Subresources.push_back({ mip, layer, offset, mipSize });
+            offset += mipSize;
+        }
+    }
+}
+
+} /* namespace RHI */
@@ -0,0 +1,78 @@
+#pragma once
+#include "Resources.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace RHI
+{
+
+// Read only view of a whole file, pages are only read in as they are touched
+class CMappedFile
+{
+public:
+    explicit CMappedFile(const std::string& path);
+    ~CMappedFile();
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+
+    const uint8_t* GetData() const { return Data; }
+    size_t GetSize() const { return Size; }
+
+private:
+    const uint8_t* Data = nullptr;
+    size_t Size = 0;
+#ifdef _WIN32
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#endif
+};
+
+// Where one mip of one array layer lives in the file, rows tightly packed
+struct CTextureSubresource
+{
+    uint32_t MipLevel;
+    uint32_t ArrayLayer;
+    size_t Offset;
+    size_t Size;
+};
+
+// A KTX2 or DDS file, parsed in place without copying any of the texel data. Cube faces count as
+//   array layers. Throws CRHIRuntimeError if the file is malformed or uses something we can't
+//   upload as is, like supercompression
+class CTextureFile
+{
+public:
+    explicit CTextureFile(const std::string& path);
+
+    EImageType GetType() const { return Type; }
+    EFormat GetFormat() const { return Format; }
+    uint32_t GetWidth() const { return Width; }
+    uint32_t GetHeight() const { return Height; }
+    uint32_t GetDepth() const { return Depth; }
+    uint32_t GetMipLevels() const { return MipLevels; }
+    uint32_t GetArrayLayers() const { return ArrayLayers; }
+    bool IsCubeMap() const { return bIsCubeMap; }
+
+    const uint8_t* GetData() const { return File.GetData(); }
+    const std::vector<CTextureSubresource>& GetSubresources() const { return Subresources; }
+
+private:
+    void ParseKTX2();
+    void ParseDDS();
+
+    CMappedFile File;
+
+    EImageType Type = EImageType::Image2D;
+    EFormat Format = EFormat::UNDEFINED;
+    uint32_t Width = 1;
+    uint32_t Height = 1;
+    uint32_t Depth = 1;
+    uint32_t MipLevels = 1;
+    uint32_t ArrayLayers = 1;
+    bool bIsCubeMap = false;
+    std::vector<CTextureSubresource> Subresources;
+};
+
+} /* namespace RHI */
@@ -0,0 +1,99 @@
+#include "BindlessHeapVk.h"
+#include "DescriptorSetVk.h"
+#include "DeviceVk.h"
+
+namespace RHI
+{
+
+template <typename TRef> uint32_t CBindlessHeapVk::CSlots<TRef>::Allocate(TRef resource)
+{
+    uint32_t index;
+    if (!FreeIndices.empty())
+    {
+        index = FreeIndices.back();
+        FreeIndices.pop_back();
+    }
+    else
+    {
+        if (Resources.size() >= Capacity)
+            throw CRHIRuntimeError("Bindless heap is full");
+        index = static_cast<uint32_t>(Resources.size());
+        Resources.emplace_back();
+    }
+    Resources[index] = std::move(resource);
+    return index;
+}
+
+CBindlessHeapVk::CBindlessHeapVk(CDeviceVk& p)
+    : Parent(p)
+{
+    Layout = Parent.CreateDescriptorSetLayout({
+        { ImageBinding, EDescriptorType::Image, 0, EShaderStageFlags::All },
+        { StorageBufferBinding, EDescriptorType::StorageBuffer, 0, EShaderStageFlags::All },
+        { SamplerBinding, EDescriptorType::Sampler, 0, EShaderStageFlags::All },
+    });
+    Set = Layout->CreateDescriptorSet();
+
+    ImageSlots.Capacity = Parent.GetBindlessCapacity(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
+    BufferSlots.Capacity = Parent.GetBindlessCapacity(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    SamplerSlots.Capacity = Parent.GetBindlessCapacity(VK_DESCRIPTOR_TYPE_SAMPLER);
+}
+
+uint32_t CBindlessHeapVk::RegisterImageView(CImageView::Ref imageView)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    uint32_t index = ImageSlots.Allocate(imageView);
+    Set->BindImageView(std::move(imageView), ImageBinding, index);
+    return index;
+}
+
+uint32_t CBindlessHeapVk::RegisterStorageBuffer(CBuffer::Ref buffer, size_t offset, size_t range)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    uint32_t index = BufferSlots.Allocate(buffer);
+    Set->BindBuffer(std::move(buffer), offset, range, StorageBufferBinding, index);
+    return index;
+}
+
+uint32_t CBindlessHeapVk::RegisterSampler(CSampler::Ref sampler)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    uint32_t index = SamplerSlots.Allocate(sampler);
+    Set->BindSampler(std::move(sampler), SamplerBinding, index);
+    return index;
+}
+
+void CBindlessHeapVk::UnregisterImageView(uint32_t index)
+{
+    Unregister(ImageSlots, ImageBinding, index);
+}
+
+void CBindlessHeapVk::UnregisterStorageBuffer(uint32_t index)
+{
+    Unregister(BufferSlots, StorageBufferBinding, index);
+}
+
+void CBindlessHeapVk::UnregisterSampler(uint32_t index)
+{
+    Unregister(SamplerSlots, SamplerBinding, index);
+}
+
+template <typename TRef>
+void CBindlessHeapVk::Unregister(CSlots<TRef>& slots, uint32_t binding, uint32_t index)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    if (index >= slots.Resources.size() || !slots.Resources[index])
+        throw CRHIRuntimeError("Unregistering a bindless index that isn't registered");
+
+    std::static_pointer_cast<CDescriptorSetVk>(Set)->Unbind(binding, index);
+
+    // Frames in flight may still index it, so hold the resource and the index until they retire
+    TRef resource = std::move(slots.Resources[index]);
+    slots.Resources[index] = nullptr;
+    Parent.AddPostFrameCleanup([this, &slots, index, resource](CDeviceVk&) {
+        std::lock_guard<std::mutex> lk(Mutex);
+        slots.FreeIndices.push_back(index);
+    });
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "DescriptorSet.h"
+#include "VkCommon.h"
+#include <mutex>
+#include <vector>
+
+namespace RHI
+{
+
+class CBindlessHeapVk : public CBindlessHeap
+{
+public:
+    typedef std::shared_ptr<CBindlessHeapVk> Ref;
+
+    explicit CBindlessHeapVk(CDeviceVk& p);
+
+    CDescriptorSetLayout::Ref GetLayout() const override { return Layout; }
+    CDescriptorSet::Ref GetDescriptorSet() const override { return Set; }
+
+    uint32_t RegisterImageView(CImageView::Ref imageView) override;
+    uint32_t RegisterStorageBuffer(CBuffer::Ref buffer, size_t offset, size_t range) override;
+    uint32_t RegisterSampler(CSampler::Ref sampler) override;
+    void UnregisterImageView(uint32_t index) override;
+    void UnregisterStorageBuffer(uint32_t index) override;
+    void UnregisterSampler(uint32_t index) override;
+
+private:
+    // Hands out stable indices into one of the unbounded arrays
+    template <typename TRef> struct CSlots
+    {
+        uint32_t Capacity = 0;
+        std::vector<uint32_t> FreeIndices;
+        // Keeps registered resources alive while the heap references them
+        std::vector<TRef> Resources;
+
+        uint32_t Allocate(TRef resource);
+    };
+
+    template <typename TRef> void Unregister(CSlots<TRef>& slots, uint32_t binding, uint32_t index);
+
+    CDeviceVk& Parent;
+    CDescriptorSetLayout::Ref Layout;
+    CDescriptorSet::Ref Set;
+
+    std::mutex Mutex;
+    CSlots<CImageView::Ref> ImageSlots;
+    CSlots<CBuffer::Ref> BufferSlots;
+    CSlots<CSampler::Ref> SamplerSlots;
+};
+
+}
@@ -0,0 +1,130 @@
+#include "BufferHeapVk.h"
+#include "DeviceVk.h"
+
+#include <algorithm>
+
+namespace RHI
+{
+
+CBufferHeapVk::CBufferHeapVk(CDeviceVk& p)
+    : Parent(p)
+{
+}
+
+CBufferHeapVk::~CBufferHeapVk()
+{
+    // The device is idle by now and the descriptor set cache is already gone
+    for (auto& pool : Pools)
+        for (auto& block : pool.second)
+        {
+            Parent.CountFree(EMemoryCategory::Buffers, block->Allocation);
+            vmaDestroyBuffer(Parent.GetAllocator(), block->Handle, block->Allocation);
+        }
+}
+
+size_t CBufferHeapVk::GetSlotSize(size_t size)
+{
+    size_t slotSize = MinSlotSize;
+    while (slotSize < size)
+        slotSize *= 2;
+    return slotSize;
+}
+
+bool CBufferHeapVk::Allocate(size_t size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+                             CSlot& outSlot)
+{
+    assert(CanSuballocate(size));
+    CPoolKey key { usage, memoryUsage, GetSlotSize(size) };
+
+    std::lock_guard<std::mutex> lk(Mutex);
+    auto& blocks = Pools[key];
+    // Newest blocks are the most likely to have room
+    auto iter = std::find_if(blocks.rbegin(), blocks.rend(), [](const std::unique_ptr<CBlock>& b) {
+        return !b->FreeSlots.empty();
+    });
+    CBlock* block = iter != blocks.rend() ? iter->get() : CreateBlock(key);
+    if (!block)
+        return false;
+
+    uint32_t index = block->FreeSlots.back();
+    block->FreeSlots.pop_back();
+    outSlot.Handle = block->Handle;
+    outSlot.Allocation = block->Allocation;
+    outSlot.Offset = index * block->SlotSize;
+    outSlot.MappedData = block->MappedData ? block->MappedData + outSlot.Offset : nullptr;
+    outSlot.Block = block;
+    return true;
+}
+
+void CBufferHeapVk::Free(const CSlot& slot)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    CBlock* block = slot.Block;
+    block->FreeSlots.push_back(static_cast<uint32_t>(slot.Offset / block->SlotSize));
+    if (block->FreeSlots.size() < block->SlotCount)
+        return;
+
+    // Keep one empty block around so a buffer created and destroyed every frame doesn't churn
+    auto& blocks = Pools[block->Key];
+    size_t emptyBlocks = std::count_if(
+        blocks.begin(), blocks.end(),
+        [](const std::unique_ptr<CBlock>& b) { return b->FreeSlots.size() == b->SlotCount; });
+    if (emptyBlocks > 1)
+        DestroyBlock(block);
+}
+
+CBufferHeapVk::CBlock* CBufferHeapVk::CreateBlock(const CPoolKey& key)
+{
+    VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bufferInfo.size = BlockSize;
+    bufferInfo.usage = std::get<0>(key);
+    const auto& queueFamilies = Parent.GetUniqueQueueFamilies();
+    if (queueFamilies.size() > 1)
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = std::get<1>(key);
+    if (allocInfo.usage != VMA_MEMORY_USAGE_GPU_ONLY)
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    auto block = std::make_unique<CBlock>();
+    VmaAllocationInfo info;
+    if (vmaCreateBuffer(Parent.GetAllocator(), &bufferInfo, &allocInfo, &block->Handle,
+                        &block->Allocation, &info)
+        != VK_SUCCESS)
+        return nullptr;
+    Parent.CountAllocation(EMemoryCategory::Buffers, block->Allocation);
+
+    block->Key = key;
+    block->MappedData = static_cast<uint8_t*>(info.pMappedData);
+    block->SlotSize = std::get<2>(key);
+    block->SlotCount = static_cast<uint32_t>(BlockSize / block->SlotSize);
+    // Reversed, so slots are handed out from the start of the block
+    block->FreeSlots.resize(block->SlotCount);
+    for (uint32_t i = 0; i < block->SlotCount; i++)
+        block->FreeSlots[i] = block->SlotCount - 1 - i;
+
+    auto& blocks = Pools[key];
+    blocks.push_back(std::move(block));
+    return blocks.back().get();
+}
+
+void CBufferHeapVk::DestroyBlock(CBlock* block)
+{
+    // Descriptor sets are cached by handle and offset, a slot that's reused keeps them valid but
+    //   the block itself going away doesn't
+    if (auto* cache = Parent.GetDescriptorSetCache())
+        cache->Evict(GetHandleKey(block->Handle));
+    Parent.CountFree(EMemoryCategory::Buffers, block->Allocation);
+    vmaDestroyBuffer(Parent.GetAllocator(), block->Handle, block->Allocation);
+
+    auto& blocks = Pools[block->Key];
+    blocks.erase(std::find_if(blocks.begin(), blocks.end(),
+                              [=](const std::unique_ptr<CBlock>& b) { return b.get() == block; }));
+}
+
+} /* namespace RHI */
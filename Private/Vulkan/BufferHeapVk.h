@@ -0,0 +1,75 @@
+#pragma once
+#include "Resources.h"
+#include "VkCommon.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace RHI
+{
+
+// Packs small buffers into shared VkBuffers, so tens of thousands of tiny meshes don't each cost a
+//   buffer object and an allocation. Slots come in power of two sizes and every block holds slots
+//   of a single size, which keeps them aligned well enough for any kind of binding
+class CBufferHeapVk
+{
+public:
+    struct CBlock;
+
+    struct CSlot
+    {
+        VkBuffer Handle = VK_NULL_HANDLE;
+        // Of the whole block, for flushes
+        VmaAllocation Allocation = VK_NULL_HANDLE;
+        size_t Offset = 0;
+        // Null for GPU only memory
+        uint8_t* MappedData = nullptr;
+        CBlock* Block = nullptr;
+    };
+
+    explicit CBufferHeapVk(CDeviceVk& p);
+    ~CBufferHeapVk();
+    CBufferHeapVk(const CBufferHeapVk&) = delete;
+    CBufferHeapVk& operator=(const CBufferHeapVk&) = delete;
+
+    static bool CanSuballocate(size_t size) { return size > 0 && size <= MaxSlotSize; }
+
+    // Safe to call from any thread. Returns false only if the device is out of memory
+    bool Allocate(size_t size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+                  CSlot& outSlot);
+    // Only for slots the GPU is done with
+    void Free(const CSlot& slot);
+
+private:
+    static constexpr size_t MinSlotSize = 256;
+    static constexpr size_t MaxSlotSize = 64 * 1024;
+    static constexpr size_t BlockSize = 1024 * 1024;
+
+    // Usage flags, memory usage and slot size
+    typedef std::tuple<VkBufferUsageFlags, VmaMemoryUsage, size_t> CPoolKey;
+
+    static size_t GetSlotSize(size_t size);
+
+    // Needs Mutex held
+    CBlock* CreateBlock(const CPoolKey& key);
+    void DestroyBlock(CBlock* block);
+
+    CDeviceVk& Parent;
+    std::mutex Mutex;
+    std::map<CPoolKey, std::vector<std::unique_ptr<CBlock>>> Pools;
+};
+
+struct CBufferHeapVk::CBlock
+{
+    CPoolKey Key;
+    VkBuffer Handle = VK_NULL_HANDLE;
+    VmaAllocation Allocation = VK_NULL_HANDLE;
+    uint8_t* MappedData = nullptr;
+    size_t SlotSize = 0;
+    uint32_t SlotCount = 0;
+    std::vector<uint32_t> FreeSlots;
+};
+
+} /* namespace RHI */
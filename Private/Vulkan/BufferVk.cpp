@@ -1,39 +1,55 @@
 #include "BufferVk.h"
 #include "DeviceVk.h"
 
+#include <algorithm>
 #include <cstring>
 
 namespace RHI
 {
 
+VkBufferUsageFlags GetVkBufferUsage(EBufferUsageFlags usage)
+{
+    VkBufferUsageFlags result = 0;
+    if (Any(usage, EBufferUsageFlags::Index))
+        result |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    if (Any(usage, EBufferUsageFlags::Vertex))
+        result |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    if (Any(usage, EBufferUsageFlags::IndirectDraw))
+        result |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    if (Any(usage, EBufferUsageFlags::Uniform))
+        result |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    if (Any(usage, EBufferUsageFlags::Storage))
+        result |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    if (Any(usage, EBufferUsageFlags::UniformTexel))
+        result |= VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT;
+    if (Any(usage, EBufferUsageFlags::StorageTexel))
+        result |= VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
+    return result;
+}
+
 CBufferVk::CBufferVk(CDeviceVk& p, size_t size, EBufferUsageFlags usage, const void* initialData)
     : CBuffer(size, usage)
     , Parent(p)
 {
     VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
     bufferInfo.size = size;
+    const auto& queueFamilies = Parent.GetUniqueQueueFamilies();
+    if (queueFamilies.size() > 1)
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
 
     VmaAllocationCreateInfo allocInfo = {};
 
     bool gpuOnly = true;
 
-    if (Any(usage, EBufferUsageFlags::Dynamic))
+    if (Any(usage, EBufferUsageFlags::Dynamic) || Any(usage, EBufferUsageFlags::Upload)
+        || Any(usage, EBufferUsageFlags::Readback))
         gpuOnly = false;
 
-    if (Any(usage, EBufferUsageFlags::Index))
-        bufferInfo.usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-    if (Any(usage, EBufferUsageFlags::Vertex))
-        bufferInfo.usage |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    if (Any(usage, EBufferUsageFlags::IndirectDraw))
-        bufferInfo.usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
-    if (Any(usage, EBufferUsageFlags::Uniform))
-        bufferInfo.usage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-    if (Any(usage, EBufferUsageFlags::Storage))
-        bufferInfo.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-    if (Any(usage, EBufferUsageFlags::UniformTexel))
-        bufferInfo.usage |= VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT;
-    if (Any(usage, EBufferUsageFlags::StorageTexel))
-        bufferInfo.usage |= VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
+    bufferInfo.usage = GetVkBufferUsage(usage);
 
     if (gpuOnly)
     {
@@ -55,142 +71,421 @@ CBufferVk::CBufferVk(CDeviceVk& p, size_t size, EBufferUsageFlags usage, const v
         allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
     }
 
-    vmaCreateBuffer(Parent.GetAllocator(), &bufferInfo, &allocInfo, &Buffer, &Allocation, nullptr);
+    // Staging buffers come and go in bulk and are pooled elsewhere, keep them out of the heap
+    bool isStaging =
+        Any(usage, EBufferUsageFlags::Upload) || Any(usage, EBufferUsageFlags::Readback);
+    if (!isStaging && CBufferHeapVk::CanSuballocate(size)
+        && Parent.GetBufferHeap()->Allocate(size, bufferInfo.usage, allocInfo.usage, HeapSlot))
+    {
+        Buffer = HeapSlot.Handle;
+        BaseOffset = HeapSlot.Offset;
+        MappedData = HeapSlot.MappedData;
+    }
+    else
+    {
+        // Host visible buffers stay mapped for their whole life, Map just hands out the pointer
+        if (!gpuOnly)
+            allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        VmaAllocationInfo info;
+        VK(vmaCreateBuffer(Parent.GetAllocator(), &bufferInfo, &allocInfo, &Buffer, &Allocation,
+                           &info));
+        MappedData = static_cast<uint8_t*>(info.pMappedData);
+        Parent.CountAllocation(GetMemoryCategory(), Allocation);
+        CreateInfo = bufferInfo;
+        if (gpuOnly && Parent.GetDefragmenter())
+            Parent.GetDefragmenter()->Register(this, Allocation);
+    }
 
     if (initialData && gpuOnly)
     {
-        // Prepare a staging buffer
-        VkBufferCreateInfo stgbufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-        stgbufferInfo.size = size;
-        stgbufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-
-        VmaAllocationCreateInfo stgallocInfo = {};
-        stgallocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-
-        VkBuffer stagingBuffer = VK_NULL_HANDLE;
-        VmaAllocation stagingAlloc = VK_NULL_HANDLE;
-
-        vmaCreateBuffer(Parent.GetAllocator(), &stgbufferInfo, &stgallocInfo, &stagingBuffer,
-                        &stagingAlloc, nullptr);
-
-        void* mappedData;
-        vmaMapMemory(Parent.GetAllocator(), stagingAlloc, &mappedData);
-        memcpy(mappedData, initialData, size);
-        vmaUnmapMemory(Parent.GetAllocator(), stagingAlloc);
-
-        // Copy the content
-        auto cmdList = Parent.GetDefaultCopyQueue()->CreateCommandList();
-        cmdList->Enqueue();
-        auto ctx = std::static_pointer_cast<CCommandContextVk>(cmdList->CreateCopyContext());
-        auto cmdBuffer = ctx->GetCmdBuffer();
-        VkBufferCopy copy;
-        copy.srcOffset = 0;
-        copy.dstOffset = 0;
-        copy.size = size;
-        vkCmdCopyBuffer(cmdBuffer, stagingBuffer, Buffer, 1, &copy);
-        ctx->FinishRecording();
-        cmdList->Commit();
-        Parent.GetDefaultCopyQueue()->Flush();
-
-        Parent.AddPostFrameCleanup([stagingBuffer, stagingAlloc](CDeviceVk& p) {
-            vmaDestroyBuffer(p.GetAllocator(), stagingBuffer, stagingAlloc);
-        });
+        VkBuffer buffer = Buffer;
+        size_t baseOffset = BaseOffset;
+        auto record = [buffer, baseOffset, size](CCommandContextVk& ctx, VkBuffer staging,
+                                                 size_t offset) {
+            VkBufferCopy copy;
+            copy.srcOffset = offset;
+            copy.dstOffset = baseOffset;
+            copy.size = size;
+            vkCmdCopyBuffer(ctx.GetCmdBuffer(), staging, buffer, 1, &copy);
+        };
+        Parent.GetUploadManager()->Upload(initialData, size, 4, record);
     }
     else if (initialData)
     {
-        void* mappedData;
-        vmaMapMemory(Parent.GetAllocator(), Allocation, &mappedData);
-        memcpy(mappedData, initialData, size);
-        vmaUnmapMemory(Parent.GetAllocator(), Allocation);
+        memcpy(MappedData, initialData, size);
+        FlushRange(0, size);
     }
 }
 
+CBufferVk::CBufferVk(CDeviceVk& p, VkBuffer buffer, size_t size, EBufferUsageFlags usage,
+                     void* mappedData)
+    : CBuffer(size, usage)
+    , Parent(p)
+    , Buffer(buffer)
+    , MappedData(static_cast<uint8_t*>(mappedData))
+{
+}
+
 CBufferVk::~CBufferVk()
 {
+    if (HeapSlot.Block)
+    {
+        // The block stays alive, cached descriptor sets pointing into the slot are still valid
+        auto slot = HeapSlot;
+        Parent.AddPostFrameCleanup([slot](CDeviceVk& p) { p.GetBufferHeap()->Free(slot); });
+        return;
+    }
+    // The owner evicts and destroys it
+    if (!Allocation)
+        return;
+    if (auto* defragmenter = Parent.GetDefragmenter())
+        defragmenter->Unregister(Allocation);
+    if (auto* cache = Parent.GetDescriptorSetCache())
+        cache->Evict(GetHandleKey(Buffer));
     auto b = Buffer;
     auto a = Allocation;
-    Parent.AddPostFrameCleanup([b, a](CDeviceVk& p) { vmaDestroyBuffer(p.GetAllocator(), b, a); });
+    auto category = GetMemoryCategory();
+    Parent.AddPostFrameCleanup([b, a, category](CDeviceVk& p) {
+        p.CountFree(category, a);
+        vmaDestroyBuffer(p.GetAllocator(), b, a);
+    });
+}
+
+EMemoryCategory CBufferVk::GetMemoryCategory() const
+{
+    if (Any(Usage, EBufferUsageFlags::Upload) || Any(Usage, EBufferUsageFlags::Readback))
+        return EMemoryCategory::Staging;
+    return EMemoryCategory::Buffers;
 }
 
 void* CBufferVk::Map(size_t offset, size_t size)
 {
-    void* result;
-    vmaMapMemory(Parent.GetAllocator(), Allocation, &result);
-    return static_cast<uint8_t*>(result) + offset;
+    if (!MappedData)
+        throw CRHIRuntimeError("Only Dynamic, Upload and Readback buffers can be mapped");
+
+    // Keeps Map/Unmap pairs correct on memory that isn't host coherent
+    if (Any(Usage, EBufferUsageFlags::Readback))
+        InvalidateRange(offset, size);
+    MappedOffset = offset;
+    MappedSize = size;
+    return MappedData + offset;
 }
 
-void CBufferVk::Unmap() { vmaUnmapMemory(Parent.GetAllocator(), Allocation); }
+void CBufferVk::Unmap()
+{
+    if (!Any(Usage, EBufferUsageFlags::Readback))
+        FlushRange(MappedOffset, MappedSize);
+    MappedOffset = 0;
+    MappedSize = 0;
+}
 
-CPersistentMappedRingBuffer::CPersistentMappedRingBuffer(CDeviceVk& p, size_t size,
-                                                         VkBufferUsageFlags usage)
-    : Parent(p)
-    , TotalSize(size)
+void CBufferVk::FlushRange(size_t offset, size_t size)
 {
-    Remaining = TotalSize;
+    VmaAllocation allocation = HeapSlot.Block ? HeapSlot.Allocation : Allocation;
+    if (!allocation)
+        return;
+    // VMA skips coherent memory and rounds the range out to nonCoherentAtomSize
+    vmaFlushAllocation(Parent.GetAllocator(), allocation, BaseOffset + offset, size);
+}
 
-    VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-    bufferInfo.size = TotalSize;
-    bufferInfo.usage = usage;
+void CBufferVk::InvalidateRange(size_t offset, size_t size)
+{
+    VmaAllocation allocation = HeapSlot.Block ? HeapSlot.Allocation : Allocation;
+    if (!allocation)
+        return;
+    vmaInvalidateAllocation(Parent.GetAllocator(), allocation, BaseOffset + offset, size);
+}
 
-    VmaAllocationCreateInfo allocInfo = {};
-    allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
-    allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+void CBufferVk::Rebind()
+{
+    VkBuffer oldBuffer = Buffer;
+    VK(vkCreateBuffer(Parent.GetVkDevice(), &CreateInfo, nullptr, &Buffer));
+    VK(vmaBindBufferMemory(Parent.GetAllocator(), Allocation, Buffer));
+
+    if (auto* cache = Parent.GetDescriptorSetCache())
+        cache->Evict(GetHandleKey(oldBuffer));
+    Parent.AddPostFrameCleanup(
+        [oldBuffer](CDeviceVk& p) { vkDestroyBuffer(p.GetVkDevice(), oldBuffer, nullptr); });
+}
+
+namespace
+{
 
-    vmaCreateBuffer(Parent.GetAllocator(), &bufferInfo, &allocInfo, &Handle, &Allocation, nullptr);
+std::atomic<uint64_t> NextRingBufferId { 1 };
 
-    vmaMapMemory(Parent.GetAllocator(), Allocation, &MappedData);
+struct CThreadChunk
+{
+    uint64_t InstanceId = 0;
+    uint64_t Frame = 0;
+    void* Page = nullptr;
+    size_t Begin = 0;
+    size_t Used = 0;
+    size_t Size = 0;
+};
+
+// A slot per instance, so the constant and transient rings don't knock each other's chunks out
+constexpr size_t ThreadChunkSlots = 4;
+thread_local CThreadChunk ThreadChunks[ThreadChunkSlots];
+
+}
+
+CPersistentMappedRingBuffer::CPersistentMappedRingBuffer(CDeviceVk& p, size_t initialSize,
+                                                         EBufferUsageFlags usage,
+                                                         EMemoryCategory category)
+    : Parent(p)
+    , Usage(usage)
+    , Category(category)
+    , InitialPageCount(std::max<size_t>((initialSize + PageSize - 1) / PageSize, 1))
+    , InstanceId(NextRingBufferId++)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    for (size_t i = 0; i < InitialPageCount; i++)
+        if (CPage* page = CreatePage(PageSize))
+            FreePages.push_back(page);
 }
 
 CPersistentMappedRingBuffer::~CPersistentMappedRingBuffer()
 {
-    vmaUnmapMemory(Parent.GetAllocator(), Allocation);
-    vmaDestroyBuffer(Parent.GetAllocator(), Handle, Allocation);
+    // The device is idle by now and the descriptor set cache is already gone
+    for (auto& page : Pages)
+    {
+        Parent.CountFree(Category, page->Allocation);
+        vmaDestroyBuffer(Parent.GetAllocator(), page->Handle, page->Allocation);
+    }
+}
+
+void* CPersistentMappedRingBuffer::Allocate(size_t size, size_t alignment, VkBuffer& outBuffer,
+                                            size_t& outOffset)
+{
+    CPage* page = AllocateFromPage(size, alignment, outOffset);
+    if (!page)
+        return nullptr;
+    outBuffer = page->Handle;
+    return page->MappedData + outOffset;
+}
+
+void* CPersistentMappedRingBuffer::Allocate(size_t size, size_t alignment,
+                                            CBufferVk::Ref& outBuffer, size_t& outOffset)
+{
+    CPage* page = AllocateFromPage(size, alignment, outOffset);
+    if (!page)
+        return nullptr;
+    outBuffer = page->Buffer;
+    return page->MappedData + outOffset;
+}
+
+CPersistentMappedRingBuffer::CPage*
+CPersistentMappedRingBuffer::AllocateFromPage(size_t size, size_t alignment, size_t& outOffset)
+{
+    uint64_t frame = CurrFrame.load();
+    auto& chunk = ThreadChunks[InstanceId % ThreadChunkSlots];
+    if (chunk.InstanceId != InstanceId || chunk.Frame != frame)
+    {
+        chunk = CThreadChunk {};
+        chunk.InstanceId = InstanceId;
+        chunk.Frame = frame;
+    }
+
+    // Chunks start on a ChunkSize boundary, so aligning within the chunk is enough
+    size_t allocOffset = (chunk.Used + alignment - 1) / alignment * alignment;
+    if (allocOffset + size > chunk.Size)
+    {
+        // Too big to share a chunk, give it a run of its own
+        if (size + alignment > ChunkSize)
+        {
+            uint64_t unused;
+            return Reserve(size, outOffset, unused);
+        }
+
+        // A block may have ended since we looked, the chunk goes with the one it came from
+        CPage* page = Reserve(ChunkSize, chunk.Begin, chunk.Frame);
+        if (!page)
+            return nullptr;
+        chunk.Page = page;
+        chunk.Size = ChunkSize;
+        allocOffset = 0;
+    }
+
+    chunk.Used = allocOffset + size;
+    outOffset = chunk.Begin + allocOffset;
+    return static_cast<CPage*>(chunk.Page);
+}
+
+CPersistentMappedRingBuffer::CPage*
+CPersistentMappedRingBuffer::Reserve(size_t size, size_t& outOffset, uint64_t& outFrame)
+{
+    size = (size + ChunkSize - 1) / ChunkSize * ChunkSize;
+    if (size > PageSize)
+    {
+        std::lock_guard<std::mutex> lk(Mutex);
+        CPage* page = CreatePage(size);
+        if (!page)
+            return nullptr;
+        page->Head = size;
+        page->Frame = CurrFrame.load();
+        CurrBlockPages.push_back(page);
+        outOffset = 0;
+        outFrame = page->Frame;
+        return page;
+    }
+
+    for (;;)
+    {
+        CPage* page = CurrPage.load();
+        if (page)
+        {
+            size_t offset = page->Head.fetch_add(size);
+            // MarkBlockEnd closes the page before it reads Head to flush. Still open means the
+            //   flush covers this, otherwise it would go out unflushed with the old block
+            uint64_t frame = page->Frame.load();
+            if (offset + size <= page->Size && frame != ClosedFrame)
+            {
+                outOffset = offset;
+                outFrame = frame;
+                return page;
+            }
+        }
+
+        std::lock_guard<std::mutex> lk(Mutex);
+        // Somebody else may have moved on to a new page while we waited
+        if (CurrPage.load() == page)
+        {
+            CPage* next = AcquirePage();
+            if (!next)
+                return nullptr;
+            CurrPage = next;
+        }
+    }
 }
 
-void* CPersistentMappedRingBuffer::Allocate(size_t size, size_t alignment, size_t& outOffset)
+CPersistentMappedRingBuffer::CPage* CPersistentMappedRingBuffer::AcquirePage()
 {
-    if (CurrBlock.End + size + alignment > TotalSize)
+    CPage* page;
+    if (!FreePages.empty())
     {
-        size_t wastedSpace = TotalSize - CurrBlock.End;
-        if (wastedSpace > Remaining)
-            return nullptr; // Not enough free space to wrap around
-        // Wrap around
-        CurrBlock.End = 0;
-        Remaining -= wastedSpace;
+        page = FreePages.back();
+        FreePages.pop_back();
     }
-    size_t allocOffset = (CurrBlock.End + alignment - 1) / alignment * alignment;
-    size_t wastedOnAlighment = allocOffset - CurrBlock.End;
-    if (allocOffset + size > TotalSize)
+    else if (!(page = CreatePage(PageSize)))
         return nullptr;
+    page->Frame = CurrFrame.load();
+    CurrBlockPages.push_back(page);
+    return page;
+}
 
-    Remaining = Remaining - wastedOnAlighment - size;
-    CurrBlock.End = allocOffset + size;
+CPersistentMappedRingBuffer::CPage* CPersistentMappedRingBuffer::CreatePage(size_t size)
+{
+    VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bufferInfo.size = size;
+    bufferInfo.usage = GetVkBufferUsage(Usage);
+    const auto& queueFamilies = Parent.GetUniqueQueueFamilies();
+    if (queueFamilies.size() > 1)
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    auto page = std::make_unique<CPage>();
+    VmaAllocationInfo pageInfo;
+    if (vmaCreateBuffer(Parent.GetAllocator(), &bufferInfo, &allocInfo, &page->Handle,
+                        &page->Allocation, &pageInfo)
+        != VK_SUCCESS)
+        return nullptr;
+    Parent.CountAllocation(Category, page->Allocation);
+    page->MappedData = static_cast<char*>(pageInfo.pMappedData);
+    page->Size = size;
+    page->Buffer = std::make_shared<CBufferVk>(Parent, page->Handle, size,
+                                               Usage | EBufferUsageFlags::Dynamic,
+                                               pageInfo.pMappedData);
+    Pages.push_back(std::move(page));
+    return Pages.back().get();
+}
 
-    outOffset = allocOffset;
-    return reinterpret_cast<void*>(reinterpret_cast<size_t>(MappedData) + allocOffset);
+void CPersistentMappedRingBuffer::DestroyPage(CPage* page)
+{
+    // Cached sets with a dynamic offset into the page would outlive it
+    if (auto* cache = Parent.GetDescriptorSetCache())
+        cache->Evict(GetHandleKey(page->Handle));
+    Parent.CountFree(Category, page->Allocation);
+    vmaDestroyBuffer(Parent.GetAllocator(), page->Handle, page->Allocation);
+    Pages.erase(std::find_if(Pages.begin(), Pages.end(),
+                             [=](const std::unique_ptr<CPage>& p) { return p.get() == page; }));
 }
 
 void CPersistentMappedRingBuffer::MarkBlockEnd()
 {
-    vmaFlushAllocation(Parent.GetAllocator(), Allocation, CurrBlock.Begin,
-                       CurrBlock.End - CurrBlock.Begin);
+    std::lock_guard<std::mutex> lk(Mutex);
+
+    // Threads notice the new frame and drop their chunks, whatever they reserve from now on
+    //   lands in a page of the next block
+    CurrPage = nullptr;
+    CurrFrame++;
+
+    BlockInfo block;
+    block.Pages.swap(CurrBlockPages);
+    for (CPage* page : block.Pages)
+        page->Frame = ClosedFrame;
+    size_t usage = 0;
+    for (CPage* page : block.Pages)
+    {
+        size_t used = std::min(page->Head.load(), page->Size);
+        vmaFlushAllocation(Parent.GetAllocator(), page->Allocation, 0, used);
+        usage += used;
+    }
 
-    AllocatedBlocks.push(CurrBlock);
-    CurrBlock.Begin = CurrBlock.End;
-    if (CurrBlock.Begin == TotalSize)
-        CurrBlock.Begin = 0;
-    CurrBlock.End = CurrBlock.Begin;
+    LastFrameUsage = usage;
+    PeakFrameUsage = std::max(PeakFrameUsage, usage);
+    WindowPeakPages = std::max(WindowPeakPages, block.Pages.size());
+    AllocatedBlocks.push(std::move(block));
 }
 
 void CPersistentMappedRingBuffer::FreeBlock()
 {
-    const auto& firstBlock = AllocatedBlocks.front();
-    size_t blockSize = firstBlock.End - firstBlock.Begin;
-    if (firstBlock.End < firstBlock.Begin)
-        blockSize = firstBlock.End - firstBlock.Begin + TotalSize;
-    Remaining += blockSize;
-    assert(Remaining <= TotalSize);
+    std::lock_guard<std::mutex> lk(Mutex);
+
+    assert(!AllocatedBlocks.empty());
+    for (CPage* page : AllocatedBlocks.front().Pages)
+    {
+        if (page->Size != PageSize)
+        {
+            // Made for one oversized allocation, not worth keeping
+            DestroyPage(page);
+            continue;
+        }
+        page->Head = 0;
+        FreePages.push_back(page);
+    }
     AllocatedBlocks.pop();
+
+    if (++FreedBlocks % TrimInterval == 0)
+    {
+        // Keep enough for every frame in flight to hit the recent peak again
+        size_t keepPages = std::max(InitialPageCount, WindowPeakPages * FramesInFlight);
+        while (Pages.size() > keepPages && !FreePages.empty())
+        {
+            DestroyPage(FreePages.back());
+            FreePages.pop_back();
+        }
+        WindowPeakPages = 0;
+    }
+}
+
+CConstantMemoryStats CPersistentMappedRingBuffer::GetStats() const
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+
+    CConstantMemoryStats stats;
+    for (const auto& page : Pages)
+        stats.Capacity += page->Size;
+    stats.LastFrameUsage = LastFrameUsage;
+    stats.PeakFrameUsage = PeakFrameUsage;
+    return stats;
 }
 
 }
@@ -1,7 +1,13 @@
 #pragma once
+#include "BufferHeapVk.h"
+#include "DescriptorSet.h"
 #include "Resources.h"
 #include "VkCommon.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <vector>
 
 namespace RHI
 {
@@ -12,54 +18,130 @@ public:
     typedef std::shared_ptr<CBufferVk> Ref;
 
     CBufferVk(CDeviceVk& p, size_t size, EBufferUsageFlags usage, const void* initialData);
+    // Wraps a buffer somebody else owns and flushes, like a page of a ring buffer
+    CBufferVk(CDeviceVk& p, VkBuffer buffer, size_t size, EBufferUsageFlags usage,
+              void* mappedData);
     ~CBufferVk() override;
 
+    // Small buffers share a VkBuffer with others, every use has to add the offset to its own
     const VkBuffer& GetHandle() const { return Buffer; }
+    size_t GetOffset() const { return BaseOffset; }
 
     void* Map(size_t offset, size_t size);
     void Unmap();
+    void FlushRange(size_t offset, size_t size);
+    void InvalidateRange(size_t offset, size_t size);
+    // Called by the defragmenter once the allocation has moved, the handle changes
+    void Rebind();
 
 private:
+    EMemoryCategory GetMemoryCategory() const;
+
     CDeviceVk& Parent;
 
     VkBuffer Buffer;
-    VmaAllocation Allocation;
+    VkBufferCreateInfo CreateInfo {};
+    size_t BaseOffset = 0;
+    // Null if the buffer is borrowed or lives in the buffer heap
+    VmaAllocation Allocation = VK_NULL_HANDLE;
+    CBufferHeapVk::CSlot HeapSlot;
+    // Null for GPU only buffers
+    uint8_t* MappedData = nullptr;
+    size_t MappedOffset = 0;
+    size_t MappedSize = 0;
 };
 
+VkBufferUsageFlags GetVkBufferUsage(EBufferUsageFlags usage);
+
+// Memory for constants or transient geometry that only lives until the frame retires. Made of
+//   fixed size pages that are handed to frames as they need them, so a heavy frame grows the ring
+//   instead of failing, and pages left over once the peak has passed are released again
 class CPersistentMappedRingBuffer
 {
 public:
-    CPersistentMappedRingBuffer(CDeviceVk& p, size_t size, VkBufferUsageFlags usage);
+    CPersistentMappedRingBuffer(CDeviceVk& p, size_t initialSize, EBufferUsageFlags usage,
+                                EMemoryCategory category);
     ~CPersistentMappedRingBuffer();
     CPersistentMappedRingBuffer(const CPersistentMappedRingBuffer&) = delete;
     CPersistentMappedRingBuffer(CPersistentMappedRingBuffer&&) = delete;
     CPersistentMappedRingBuffer& operator=(const CPersistentMappedRingBuffer&) = delete;
     CPersistentMappedRingBuffer& operator=(CPersistentMappedRingBuffer&&) = delete;
 
-    void* Allocate(size_t size, size_t alignment, size_t& outOffset);
+    // Safe to call from any thread, each thread sub-allocates from its own chunk. Returns null
+    //   only if the device is out of memory. Memory goes back with the frame it was allocated
+    //   in, so recording must not overlap the MarkBlockEnd that closes that frame
+    void* Allocate(size_t size, size_t alignment, VkBuffer& outBuffer, size_t& outOffset);
+    // Same, but hands out the page as a CBuffer that can be bound like any other
+    void* Allocate(size_t size, size_t alignment, CBufferVk::Ref& outBuffer, size_t& outOffset);
+    // Called by the queue once a frame, everything allocated so far belongs to that frame
     void MarkBlockEnd();
+    // Called when the oldest frame retires
     void FreeBlock();
 
-    VkBuffer GetHandle() const { return Handle; }
+    CConstantMemoryStats GetStats() const;
 
 private:
-    CDeviceVk& Parent;
-
-    VkBuffer Handle;
-    VmaAllocation Allocation;
-
-    size_t TotalSize;
-    size_t Remaining;
+    // What a thread reserves at once
+    static constexpr size_t ChunkSize = 64 * 1024;
+    // Allocations bigger than this get a page of their own
+    static constexpr size_t PageSize = 1024 * 1024;
+    // Spare pages are trimmed to the peak of the last this many frames
+    static constexpr uint64_t TrimInterval = 240;
+    // The frame being recorded plus the ones the GPU may still be reading
+    static constexpr size_t FramesInFlight = 4;
+    static constexpr uint64_t ClosedFrame = ~0ull;
+
+    struct CPage
+    {
+        VkBuffer Handle = VK_NULL_HANDLE;
+        VmaAllocation Allocation = VK_NULL_HANDLE;
+        // Borrows Handle
+        CBufferVk::Ref Buffer;
+        char* MappedData = nullptr;
+        size_t Size = 0;
+        // Bumped past Size once the page is full
+        std::atomic<size_t> Head { 0 };
+        // The frame the page was handed out in, ClosedFrame once its block has ended or while
+        //   it's free. Checked after reserving, the page may have been closed in between
+        std::atomic<uint64_t> Frame { ClosedFrame };
+    };
 
     struct BlockInfo
     {
-        size_t Begin = 0;
-        size_t End = 0;
+        std::vector<CPage*> Pages;
     };
-    BlockInfo CurrBlock;
+
+    CPage* AllocateFromPage(size_t size, size_t alignment, size_t& outOffset);
+    // Reserves whole chunks from the current page, moving on to another page when it's full.
+    //   outFrame is the frame the reservation belongs to
+    CPage* Reserve(size_t size, size_t& outOffset, uint64_t& outFrame);
+    // All of these need Mutex held
+    CPage* AcquirePage();
+    CPage* CreatePage(size_t size);
+    void DestroyPage(CPage* page);
+
+    CDeviceVk& Parent;
+    EBufferUsageFlags Usage;
+    EMemoryCategory Category;
+    size_t InitialPageCount;
+    // Tells the thread local chunks apart from other instances
+    uint64_t InstanceId;
+    // Chunks reserved in an earlier frame are abandoned, so every block ends on a chunk boundary
+    std::atomic<uint64_t> CurrFrame { 0 };
+    std::atomic<CPage*> CurrPage { nullptr };
+
+    mutable std::mutex Mutex;
+    std::vector<std::unique_ptr<CPage>> Pages;
+    std::vector<CPage*> FreePages;
+    // Pages handed out since the last MarkBlockEnd
+    std::vector<CPage*> CurrBlockPages;
     std::queue<BlockInfo> AllocatedBlocks;
 
-    void* MappedData;
+    size_t LastFrameUsage = 0;
+    size_t PeakFrameUsage = 0;
+    // Most pages a single frame needed since the last trim
+    size_t WindowPeakPages = 0;
+    uint64_t FreedBlocks = 0;
 };
 
 } /* namespace RHI */
@@ -92,7 +92,8 @@ CCommandBufferVk::~CCommandBufferVk()
     BufferAllocator = nullptr;
 }
 
-void CCommandBufferVk::BeginRecording(CRenderPass::Ref renderPass, uint32_t subpass)
+void CCommandBufferVk::BeginRecording(CRenderPass::Ref renderPass, uint32_t subpass,
+                                      VkCommandBufferUsageFlags usage)
 {
     VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
     VkCommandBufferInheritanceInfo inheritInfo = {
@@ -116,7 +117,7 @@ void CCommandBufferVk::BeginRecording(CRenderPass::Ref renderPass, uint32_t subp
         beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
     }
 
-    beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.flags |= usage;
     VK(vkBeginCommandBuffer(Handle, &beginInfo));
 }
 
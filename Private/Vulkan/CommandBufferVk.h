@@ -66,7 +66,8 @@ public:
     ~CCommandBufferVk();
 
     VkCommandBuffer GetHandle() const { return Handle; }
-    void BeginRecording(CRenderPass::Ref renderPass, uint32_t subpass);
+    void BeginRecording(CRenderPass::Ref renderPass, uint32_t subpass,
+                        VkCommandBufferUsageFlags usage = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
     void EndRecording();
 
 private:
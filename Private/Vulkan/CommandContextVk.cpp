@@ -51,6 +51,19 @@ IRenderContext::Ref CRenderPassContextVk::CreateRenderContext(uint32_t subpass)
     return std::make_shared<CCommandContextVk>(shared_from_this(), subpass);
 }
 
+void CRenderPassContextVk::ExecuteBundle(uint32_t subpass, CRenderBundle::Ref bundle)
+{
+    auto bundleImpl = std::static_pointer_cast<CRenderBundleVk>(bundle);
+    if (!bundleImpl->IsRecorded())
+        throw CRHIRuntimeError("Render bundle executed before it finished recording");
+    if (bundleImpl->GetSubpass() != subpass)
+        throw CRHIRuntimeError("Render bundle was recorded for a different subpass");
+
+    std::lock_guard<tc::FSpinLock> lk(SpinLock);
+    SubpassInfos[subpass].emplace_back();
+    SubpassInfos[subpass].back().Bundle = std::move(bundleImpl);
+}
+
 void CRenderPassContextVk::FinishRecording()
 {
     static_assert(sizeof(VkClearValue) == sizeof(CClearValue), "Struct sizes mismatch");
@@ -91,6 +104,15 @@ void CRenderPassContextVk::FinishRecording()
             std::vector<VkCommandBuffer> secondaryBuffers;
             for (auto& subpassInfo : SubpassInfos[i])
             {
+                if (subpassInfo.Bundle)
+                {
+                    secondaryBuffers.emplace_back(subpassInfo.Bundle->GetHandle());
+                    section.AccessTracker.Merge(VK_NULL_HANDLE,
+                                                subpassInfo.Bundle->GetAccessTracker());
+                    section.Bundles.emplace_back(std::move(subpassInfo.Bundle));
+                    continue;
+                }
+
                 auto& bufferRef = subpassInfo.SecondaryBuffer;
                 secondaryBuffers.emplace_back(bufferRef->GetHandle());
                 section.SecondaryBuffers.emplace_back(std::move(bufferRef));
@@ -129,6 +151,34 @@ void CRenderPassContextVk::FinishRecording()
     CmdList.reset();
 }
 
+CRenderBundleVk::CRenderBundleVk(CCommandQueueVk& queue, CRenderPass::Ref renderPass,
+                                 uint32_t subpass)
+    : Queue(queue)
+    , RenderPass(std::move(renderPass))
+    , Subpass(subpass)
+{
+    auto rpImpl = std::static_pointer_cast<CRenderPassVk>(RenderPass);
+    if (Subpass >= rpImpl->GetSubpassCount())
+        throw CRHIRuntimeError("Render bundle subpass out of range");
+}
+
+CRenderBundleVk::~CRenderBundleVk()
+{
+    for (VkDescriptorSet handle : HeldSets)
+        Queue.GetDevice().GetDescriptorSetCache()->Release(handle);
+}
+
+IRenderContext::Ref CRenderBundleVk::CreateRenderContext()
+{
+    if (bIsRecording || bIsRecorded)
+        throw CRHIRuntimeError("A render bundle can only be recorded once");
+    bIsRecording = true;
+
+    CmdBuffer = Queue.GetCmdBufferAllocator().Allocate(true);
+    CmdBuffer->BeginRecording(RenderPass, Subpass, VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
+    return std::make_shared<CCommandContextVk>(shared_from_this());
+}
+
 void CCommandContextVk::Convert(VkOffset2D& dst, const COffset2D& src)
 {
     static_assert(sizeof(VkOffset2D) == sizeof(COffset2D), "struct size mismatch");
@@ -245,12 +295,23 @@ CCommandContextVk::CCommandContextVk(const CRenderPassContextVk::Ref& renderPass
     auto& subpassInfo = renderPassContext->GetSubpassInfo(subpass, CmdBufferIndex);
     subpassInfo.SecondaryBuffer = std::move(cmdBuffer);
 
-    auto rpImpl = std::static_pointer_cast<CRenderPassVk>(RenderPassContext->GetRenderPass());
+    ResetViewportAndScissor(*RenderPassContext->GetRenderPass());
+}
+
+CCommandContextVk::CCommandContextVk(const CRenderBundleVk::Ref& bundle)
+    : Bundle(bundle)
+{
+    ResetViewportAndScissor(*Bundle->GetRenderPass());
+}
+
+void CCommandContextVk::ResetViewportAndScissor(CRenderPass& renderPass)
+{
+    auto& rpImpl = static_cast<CRenderPassVk&>(renderPass);
     CViewportDesc vp {};
     vp.X = 0.0f;
     vp.Y = 0.0f;
-    vp.Width = static_cast<float>(rpImpl->GetArea().extent.width);
-    vp.Height = static_cast<float>(rpImpl->GetArea().extent.height);
+    vp.Width = static_cast<float>(rpImpl.GetArea().extent.width);
+    vp.Height = static_cast<float>(rpImpl.GetArea().extent.height);
     vp.MinDepth = 0.0f;
     vp.MaxDepth = 1.0f;
     SetViewport(vp);
@@ -272,19 +333,16 @@ CCommandContextVk::~CCommandContextVk()
 void CCommandContextVk::TransitionImage(CImage& image, EResourceState newState)
 {
     auto& imageImpl = static_cast<CImageVk&>(image);
-    CImageSubresourceRange range;
-    range.BaseArrayLayer = 0;
-    range.BaseMipLevel = 0;
-    range.LayerCount = imageImpl.GetArrayLayers();
-    range.LevelCount = imageImpl.GetMipLevels();
-    AccessTracker().TransitionImageState(CmdBuffer(), &imageImpl, range, newState,
-                                         CmdList->GetQueue().GetType() == EQueueType::Copy);
+    TransitionImage(image, 0, imageImpl.GetMipLevels(), 0, imageImpl.GetArrayLayers(), newState);
 }
 
 void CCommandContextVk::TransitionImage(CImage& image, uint32_t baseMip, uint32_t mipCount,
                                         uint32_t baseLayer, uint32_t layerCount,
                                         EResourceState newState)
 {
+    // The layout a bundle would leave the image in depends on where it's executed
+    if (Bundle)
+        throw CRHIRuntimeError("Render bundles can't transition images");
     auto& imageImpl = static_cast<CImageVk&>(image);
     CImageSubresourceRange range;
     range.BaseArrayLayer = baseLayer;
@@ -295,8 +353,9 @@ void CCommandContextVk::TransitionImage(CImage& image, uint32_t baseMip, uint32_
         throw CRHIRuntimeError("TransitionImage range out of bounds");
     if (range.BaseMipLevel + range.LevelCount > imageImpl.GetMipLevels())
         throw CRHIRuntimeError("TransitionImage range out of bounds");
-    AccessTracker().TransitionImageState(CmdBuffer(), &imageImpl, range, newState,
-                                         CmdList->GetQueue().GetType() == EQueueType::Copy);
+    // Render passes never run on the copy queue
+    bool bIsCopyQueue = CmdList && CmdList->GetQueue().GetType() == EQueueType::Copy;
+    AccessTracker().TransitionImageState(CmdBuffer(), &imageImpl, range, newState, bIsCopyQueue);
 }
 
 void CCommandContextVk::ClearImage(CImage& image, const CClearValue& clearValue,
@@ -325,11 +384,18 @@ void CCommandContextVk::CopyBuffer(CBuffer& src, CBuffer& dst,
                                    const std::vector<CBufferCopy>& regions)
 {
     static_assert(sizeof(CBufferCopy) == sizeof(VkBufferCopy), "struct size mismatch");
-    const auto* r = reinterpret_cast<const VkBufferCopy*>(regions.data());
+    auto& srcImpl = static_cast<CBufferVk&>(src);
+    auto& dstImpl = static_cast<CBufferVk&>(dst);
+    const auto* begin = reinterpret_cast<const VkBufferCopy*>(regions.data());
+    std::vector<VkBufferCopy> r(begin, begin + regions.size());
+    for (auto& region : r)
+    {
+        region.srcOffset += srcImpl.GetOffset();
+        region.dstOffset += dstImpl.GetOffset();
+    }
 
-    vkCmdCopyBuffer(CmdBuffer(), static_cast<CBufferVk&>(src).GetHandle(),
-                    static_cast<CBufferVk&>(dst).GetHandle(), static_cast<uint32_t>(regions.size()),
-                    r);
+    vkCmdCopyBuffer(CmdBuffer(), srcImpl.GetHandle(), dstImpl.GetHandle(),
+                    static_cast<uint32_t>(r.size()), r.data());
 }
 
 void CCommandContextVk::CopyImage(CImage& src, CImage& dst, const std::vector<CImageCopy>& regions)
@@ -361,6 +427,7 @@ void CCommandContextVk::CopyBufferToImage(CBuffer& src, CImage& dst,
     {
         VkBufferImageCopy next;
         Convert(next, rs);
+        next.bufferOffset += static_cast<CBufferVk&>(src).GetOffset();
         vkregions.push_back(next);
 
         TransitionImage(dst, rs.ImageSubresource.MipLevel, 1, rs.ImageSubresource.BaseArrayLayer,
@@ -380,6 +447,7 @@ void CCommandContextVk::CopyImageToBuffer(CImage& src, CBuffer& dst,
     {
         VkBufferImageCopy next;
         Convert(next, rs);
+        next.bufferOffset += static_cast<CBufferVk&>(dst).GetOffset();
         vkregions.push_back(next);
 
         TransitionImage(src, rs.ImageSubresource.MipLevel, 1, rs.ImageSubresource.BaseArrayLayer,
@@ -436,6 +504,59 @@ void CCommandContextVk::ResolveImage(CImage& src, CImage& dst,
                       static_cast<uint32_t>(r.size()), r.data());
 }
 
+CReadback::Ref CCommandContextVk::ReadbackBuffer(CBuffer& src, size_t offset, size_t size)
+{
+    if (!CmdList)
+        throw CRHIRuntimeError("Readbacks have to be recorded outside of render passes");
+    auto buffer = CmdList->GetQueue().GetDevice().GetReadbackPool()->Acquire(size);
+
+    VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(CmdBuffer(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    auto& srcImpl = static_cast<CBufferVk&>(src);
+    VkBufferCopy copy;
+    copy.srcOffset = srcImpl.GetOffset() + offset;
+    copy.dstOffset = buffer->GetOffset();
+    copy.size = size;
+    vkCmdCopyBuffer(CmdBuffer(), srcImpl.GetHandle(), buffer->GetHandle(), 1, &copy);
+    return FinishReadback(std::move(buffer), size);
+}
+
+CReadback::Ref CCommandContextVk::ReadbackImage(CImage& src, const CBufferImageCopy& region)
+{
+    if (!CmdList)
+        throw CRHIRuntimeError("Readbacks have to be recorded outside of render passes");
+
+    // Row length and image height are in texels, 0 meaning tightly packed
+    auto& srcImpl = static_cast<CImageVk&>(src);
+    CFormatInfo info = GetFormatInfo(srcImpl.GetFormat());
+    uint32_t rowLength = region.BufferRowLength ? region.BufferRowLength : region.ImageExtent.Width;
+    uint32_t imageHeight =
+        region.BufferImageHeight ? region.BufferImageHeight : region.ImageExtent.Height;
+    size_t size = info.GetSliceSize(rowLength, imageHeight) * region.ImageExtent.Depth
+        * region.ImageSubresource.LayerCount;
+    auto buffer = CmdList->GetQueue().GetDevice().GetReadbackPool()->Acquire(size);
+
+    CBufferImageCopy atStart = region;
+    atStart.BufferOffset = 0;
+    CopyImageToBuffer(src, *buffer, { atStart });
+    return FinishReadback(std::move(buffer), size);
+}
+
+CReadback::Ref CCommandContextVk::FinishReadback(std::shared_ptr<CBufferVk> buffer, size_t size)
+{
+    // The fence alone doesn't make transfer writes visible to the host
+    VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(CmdBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+    return std::make_shared<CReadbackVk>(CmdList, std::move(buffer), size);
+}
+
 void CCommandContextVk::BindComputePipeline(CPipeline& pipeline)
 {
     auto& impl = static_cast<CPipelineVk&>(pipeline);
@@ -451,6 +572,17 @@ void CCommandContextVk::BindComputeDescriptorSet(uint32_t set, CDescriptorSet& d
     BindingDirty[set] = true;
 }
 
+void CCommandContextVk::PushConstants(uint32_t offset, uint32_t size, const void* data)
+{
+    if (!CurrPipeline)
+        throw CRHIRuntimeError("PushConstants called without a bound pipeline");
+    const auto& layout = CurrPipeline->GetPipelineLayoutObject();
+    VkShaderStageFlags stages = layout.GetPushConstantStages(offset, size);
+    if (stages == 0)
+        throw CRHIRuntimeError("PushConstants range is not declared by the pipeline layout");
+    vkCmdPushConstants(CmdBuffer(), layout.GetHandle(), stages, offset, size, data);
+}
+
 void CCommandContextVk::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
     WriteDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE);
@@ -461,7 +593,7 @@ void CCommandContextVk::DispatchIndirect(CBuffer& buffer, size_t offset)
 {
     WriteDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE);
     auto& impl = static_cast<CBufferVk&>(buffer);
-    vkCmdDispatchIndirect(CmdBuffer(), impl.GetHandle(), offset);
+    vkCmdDispatchIndirect(CmdBuffer(), impl.GetHandle(), impl.GetOffset() + offset);
 }
 
 void CCommandContextVk::BindRenderPipeline(CPipeline& pipeline)
@@ -508,14 +640,14 @@ void CCommandContextVk::BindIndexBuffer(CBuffer& buffer, size_t offset, EFormat
     auto& impl = static_cast<CBufferVk&>(buffer);
     VkIndexType indexType =
         format == EFormat::R16_UINT ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
-    vkCmdBindIndexBuffer(CmdBuffer(), impl.GetHandle(), offset, indexType);
+    vkCmdBindIndexBuffer(CmdBuffer(), impl.GetHandle(), impl.GetOffset() + offset, indexType);
 }
 
 void CCommandContextVk::BindVertexBuffer(uint32_t binding, CBuffer& buffer, size_t offset)
 {
     auto& impl = static_cast<CBufferVk&>(buffer);
     // Workaround for systems where size_t != 8
-    VkDeviceSize vkOffset = offset;
+    VkDeviceSize vkOffset = impl.GetOffset() + offset;
     vkCmdBindVertexBuffers(CmdBuffer(), binding, 1, &impl.GetHandle(), &vkOffset);
 }
 
@@ -539,16 +671,93 @@ void CCommandContextVk::DrawIndirect(CBuffer& buffer, size_t offset, uint32_t dr
                                      uint32_t stride)
 {
     WriteDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS);
-    VkBuffer vkBuffer = static_cast<CBufferVk&>(buffer).GetHandle();
-    vkCmdDrawIndirect(CmdBuffer(), vkBuffer, offset, drawCount, stride);
+    auto& impl = static_cast<CBufferVk&>(buffer);
+    vkCmdDrawIndirect(CmdBuffer(), impl.GetHandle(), impl.GetOffset() + offset, drawCount, stride);
 }
 
 void CCommandContextVk::DrawIndexedIndirect(CBuffer& buffer, size_t offset, uint32_t drawCount,
                                             uint32_t stride)
 {
     WriteDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS);
-    VkBuffer vkBuffer = static_cast<CBufferVk&>(buffer).GetHandle();
-    vkCmdDrawIndirect(CmdBuffer(), vkBuffer, offset, drawCount, stride);
+    auto& impl = static_cast<CBufferVk&>(buffer);
+    vkCmdDrawIndexedIndirect(CmdBuffer(), impl.GetHandle(), impl.GetOffset() + offset, drawCount,
+                             stride);
+}
+
+void CCommandContextVk::SubmitDrawBatch(const CDrawRecord* records, size_t count)
+{
+    VkCommandBuffer cmdBuffer = CmdBuffer();
+
+    // What this batch has bound so far, anything bound before the batch is rebound once
+    VkBuffer vertexBuffers[CDrawRecord::MaxVertexBuffers] = {};
+    VkDeviceSize vertexOffsets[CDrawRecord::MaxVertexBuffers] = {};
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize indexOffset = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_MAX_ENUM;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const CDrawRecord& record = records[i];
+
+        if (record.Pipeline && record.Pipeline != CurrPipeline)
+        {
+            auto* impl = static_cast<CPipelineVk*>(record.Pipeline);
+            // Sets bound with an incompatible layout are disturbed
+            if (CurrPipeline && CurrPipeline->GetPipelineLayout() != impl->GetPipelineLayout())
+                BindingDirty.fill(true);
+            CurrPipeline = impl;
+            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, impl->GetHandle());
+        }
+
+        for (uint32_t set = 0; set < CDrawRecord::MaxDescriptorSets; set++)
+        {
+            auto* ds = static_cast<CDescriptorSetVk*>(record.DescriptorSets[set]);
+            if (ds && ds != BoundDescriptorSets[set])
+            {
+                BoundDescriptorSets[set] = ds;
+                BindingDirty[set] = true;
+            }
+        }
+
+        for (uint32_t binding = 0; binding < CDrawRecord::MaxVertexBuffers; binding++)
+        {
+            if (!record.VertexBuffers[binding])
+                continue;
+            auto* impl = static_cast<CBufferVk*>(record.VertexBuffers[binding]);
+            VkBuffer handle = impl->GetHandle();
+            VkDeviceSize offset = impl->GetOffset() + record.VertexOffsets[binding];
+            if (handle != vertexBuffers[binding] || offset != vertexOffsets[binding])
+            {
+                vertexBuffers[binding] = handle;
+                vertexOffsets[binding] = offset;
+                vkCmdBindVertexBuffers(cmdBuffer, binding, 1, &handle, &offset);
+            }
+        }
+
+        if (record.IndexBuffer)
+        {
+            auto* impl = static_cast<CBufferVk*>(record.IndexBuffer);
+            VkBuffer handle = impl->GetHandle();
+            VkDeviceSize offset = impl->GetOffset() + record.IndexOffset;
+            VkIndexType type = record.IndexFormat == EFormat::R16_UINT ? VK_INDEX_TYPE_UINT16
+                                                                       : VK_INDEX_TYPE_UINT32;
+            if (handle != indexBuffer || offset != indexOffset || type != indexType)
+            {
+                indexBuffer = handle;
+                indexOffset = offset;
+                indexType = type;
+                vkCmdBindIndexBuffer(cmdBuffer, handle, indexOffset, type);
+            }
+        }
+
+        WriteDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS);
+        if (record.bIndexed)
+            vkCmdDrawIndexed(cmdBuffer, record.Count, record.InstanceCount, record.First,
+                             record.VertexOffset, record.FirstInstance);
+        else
+            vkCmdDraw(cmdBuffer, record.Count, record.InstanceCount, record.First,
+                      record.FirstInstance);
+    }
 }
 
 void CCommandContextVk::FinishRecording()
@@ -574,6 +783,13 @@ void CCommandContextVk::FinishRecording()
         CmdList->bIsContextActive = false;
         CmdList.reset();
     }
+    else if (Bundle)
+    {
+        Bundle->CmdBuffer->EndRecording();
+        Bundle->bIsRecording = false;
+        Bundle->bIsRecorded = true;
+        Bundle.reset();
+    }
     else
     {
         RenderPassContext->GetSubpassInfo(SubpassIndex, CmdBufferIndex)
@@ -586,6 +802,8 @@ CAccessTracker& CCommandContextVk::AccessTracker()
 {
     if (CmdList)
         return CmdList->Sections.back().AccessTracker;
+    if (Bundle)
+        return Bundle->AccessTracker;
     return RenderPassContext->GetSubpassInfo(SubpassIndex, CmdBufferIndex).AccessTracker;
 }
 
@@ -593,6 +811,8 @@ VkCommandBuffer CCommandContextVk::CmdBuffer()
 {
     if (CmdList)
         return CmdList->Sections.back().CmdBuffer->GetHandle();
+    if (Bundle)
+        return Bundle->CmdBuffer->GetHandle();
     return RenderPassContext->GetSubpassInfo(SubpassIndex, CmdBufferIndex)
         .SecondaryBuffer->GetHandle();
 }
@@ -602,9 +822,48 @@ void CCommandContextVk::WriteDescriptorSets(VkPipelineBindPoint bindPoint)
     uint32_t set = 0;
     for (auto* ds : BoundDescriptorSets)
     {
-        if (ds)
+        if (ds && Bundle)
+        {
+            // Captured at the first draw after binding, the bundle keeps its own handle since
+            //   the transient ones are recycled with the frame
+            if (BindingDirty[set] || ds->AreDynamicOffsetsDirty())
+            {
+                VkDescriptorSet setHandle = ds->AcquireForBundle(AccessTracker());
+                if (ds->IsPushDescriptor())
+                    ds->Push(CmdBuffer(), bindPoint, CurrPipeline->GetPipelineLayout(), set);
+                else
+                {
+                    if (!ds->IsPersistent())
+                        Bundle->HeldSets.push_back(setHandle);
+                    const auto& dynamicOffsets = ds->GetDynamicOffsets();
+                    vkCmdBindDescriptorSets(CmdBuffer(), bindPoint,
+                                            CurrPipeline->GetPipelineLayout(), set, 1, &setHandle,
+                                            static_cast<uint32_t>(dynamicOffsets.size()),
+                                            dynamicOffsets.data());
+                }
+                ds->ClearDynamicOffsetsDirty();
+            }
+            BindingDirty[set] = false;
+        }
+        else if (ds && ds->IsPushDescriptor())
         {
+            // Pushed descriptors stay until an incompatible pipeline layout is bound
             if (ds->IsContentDirty() || BindingDirty[set])
+            {
+                if (bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE)
+                    ds->WriteUpdates(AccessTracker(), CmdBuffer());
+                else
+                    ds->WriteUpdates(AccessTracker(), VK_NULL_HANDLE);
+
+                uint32_t count =
+                    ds->Push(CmdBuffer(), bindPoint, CurrPipeline->GetPipelineLayout(), set);
+                CurrPipeline->GetPipelineLayoutObject().GetDevice().CountPushedSet(count);
+            }
+            BindingDirty[set] = false;
+        }
+        else if (ds)
+        {
+            if (ds->IsContentDirty() || ds->AreDynamicOffsetsDirty() || BindingDirty[set])
             {
                 if (bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE)
                     ds->WriteUpdates(AccessTracker(), CmdBuffer());
@@ -612,8 +871,13 @@ void CCommandContextVk::WriteDescriptorSets(VkPipelineBindPoint bindPoint)
                     ds->WriteUpdates(AccessTracker(), VK_NULL_HANDLE);
 
                 VkDescriptorSet setHandle = ds->GetHandle();
+                const auto& dynamicOffsets = ds->GetDynamicOffsets();
                 vkCmdBindDescriptorSets(CmdBuffer(), bindPoint, CurrPipeline->GetPipelineLayout(),
-                                        set, 1, &setHandle, 0, nullptr);
+                                        set, 1, &setHandle,
+                                        static_cast<uint32_t>(dynamicOffsets.size()),
+                                        dynamicOffsets.data());
+                ds->ClearDynamicOffsetsDirty();
+                CurrPipeline->GetPipelineLayoutObject().GetDevice().CountBoundSet();
             }
             BindingDirty[set] = false;
             ds->SetUsed();
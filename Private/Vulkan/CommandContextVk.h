@@ -9,10 +9,47 @@
 namespace RHI
 {
 
+class CRenderBundleVk : public std::enable_shared_from_this<CRenderBundleVk>,
+                        public CRenderBundle
+{
+    friend class CCommandContextVk;
+
+public:
+    typedef std::shared_ptr<CRenderBundleVk> Ref;
+
+    CRenderBundleVk(CCommandQueueVk& queue, CRenderPass::Ref renderPass, uint32_t subpass);
+    ~CRenderBundleVk() override;
+
+    IRenderContext::Ref CreateRenderContext() override;
+
+    bool IsRecorded() const { return bIsRecorded; }
+    CRenderPass::Ref GetRenderPass() const { return RenderPass; }
+    uint32_t GetSubpass() const { return Subpass; }
+    VkCommandBuffer GetHandle() const { return CmdBuffer->GetHandle(); }
+    const CAccessTracker& GetAccessTracker() const { return AccessTracker; }
+
+private:
+    // Not holding a reference, same as command lists
+    CCommandQueueVk& Queue;
+    CRenderPass::Ref RenderPass;
+    uint32_t Subpass;
+
+    // A secondary buffer recorded with SIMULTANEOUS_USE so it can be in flight several times
+    std::unique_ptr<CCommandBufferVk> CmdBuffer;
+    // Summary of the accesses, merged into every render pass that executes the bundle
+    CAccessTracker AccessTracker;
+    // Cached descriptor sets the commands point at, released along with the bundle
+    std::vector<VkDescriptorSet> HeldSets;
+    bool bIsRecording = false;
+    bool bIsRecorded = false;
+};
+
 struct CSubpassInfo
 {
     std::unique_ptr<CCommandBufferVk> SecondaryBuffer;
     CAccessTracker AccessTracker;
+    // Set instead of SecondaryBuffer when a pre-recorded bundle is executed
+    CRenderBundleVk::Ref Bundle;
 };
 
 class CRenderPassContextVk : public std::enable_shared_from_this<CRenderPassContextVk>,
@@ -34,6 +71,7 @@ public:
     uint32_t MakeSubpassInfo(uint32_t subpass);
 
     IRenderContext::Ref CreateRenderContext(uint32_t subpass) override;
+    void ExecuteBundle(uint32_t subpass, CRenderBundle::Ref bundle) override;
     void FinishRecording() override;
 
 private:
@@ -67,6 +105,7 @@ public:
     explicit CCommandContextVk(const CCommandListVk::Ref& cmdList);
     explicit CCommandContextVk(const CRenderPassContextVk::Ref& renderPassContext,
                                uint32_t subpass);
+    explicit CCommandContextVk(const CRenderBundleVk::Ref& bundle);
     ~CCommandContextVk() override;
 
     void TransitionImage(CImage& image, EResourceState newState);
@@ -86,10 +125,14 @@ public:
     void BlitImage(CImage& src, CImage& dst, const std::vector<CImageBlit>& regions,
                    EFilter filter) override;
     void ResolveImage(CImage& src, CImage& dst, const std::vector<CImageResolve>& regions) override;
+    CReadback::Ref ReadbackBuffer(CBuffer& src, size_t offset, size_t size) override;
+    CReadback::Ref ReadbackImage(CImage& src, const CBufferImageCopy& region) override;
 
     // Compute commands
     void BindComputePipeline(CPipeline& pipeline) override;
     void BindComputeDescriptorSet(uint32_t set, CDescriptorSet& descriptorSet) override;
+    // Shared by compute and render
+    void PushConstants(uint32_t offset, uint32_t size, const void* data) override;
     void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
     void DispatchIndirect(CBuffer& buffer, size_t offset) override;
 
@@ -109,6 +152,7 @@ public:
     void DrawIndirect(CBuffer& buffer, size_t offset, uint32_t drawCount, uint32_t stride) override;
     void DrawIndexedIndirect(CBuffer& buffer, size_t offset, uint32_t drawCount,
                              uint32_t stride) override;
+    void SubmitDrawBatch(const CDrawRecord* records, size_t count) override;
 
     // Finish this context and save the commands into the command list
     void FinishRecording() override;
@@ -116,7 +160,10 @@ public:
 protected:
     CAccessTracker& AccessTracker();
     VkCommandBuffer CmdBuffer();
+    void ResetViewportAndScissor(CRenderPass& renderPass);
     void WriteDescriptorSets(VkPipelineBindPoint bindPoint);
+    // Makes the copy into `buffer` visible to the host and wraps it up
+    CReadback::Ref FinishReadback(std::shared_ptr<CBufferVk> buffer, size_t size);
 
 private:
     // The target we are recording into
@@ -127,6 +174,9 @@ private:
     uint32_t SubpassIndex;
     uint32_t CmdBufferIndex;
 
+    // The target when we are recording a render bundle
+    CRenderBundleVk::Ref Bundle;
+
     // Temporary states
     CPipelineVk* CurrPipeline = nullptr;
     std::array<CDescriptorSetVk*, 8> BoundDescriptorSets {};
@@ -1,6 +1,8 @@
 #include "CommandListVk.h"
 #include "CommandContextVk.h"
 #include "CommandQueueVk.h"
+#include "DeviceVk.h"
+#include <unordered_set>
 
 namespace RHI
 {
@@ -26,6 +28,15 @@ CCommandListVk::CCommandListVk(CCommandQueueVk& p)
 {
 }
 
+CCommandListVk::~CCommandListVk()
+{
+    // A consumer may still be waiting on these, or may never be submitted at all
+    for (VkSemaphore semaphore : DependencySemaphores)
+        GetQueue().GetDevice().AddPostFrameCleanup([semaphore](CDeviceVk& p) {
+            vkDestroySemaphore(p.GetVkDevice(), semaphore, nullptr);
+        });
+}
+
 void CCommandListVk::Enqueue()
 {
     if (bIsQueued)
@@ -49,6 +60,68 @@ void CCommandListVk::Commit()
     bIsCommitted = true;
 }
 
+void CCommandListVk::WaitFor(CCommandList::Ref other)
+{
+    auto otherImpl = std::static_pointer_cast<CCommandListVk>(other);
+    if (otherImpl.get() == this)
+        throw CRHIRuntimeError("A command list can't wait for itself");
+    // Waiting on a list enqueued behind us would stall the queue forever, and one enqueued
+    //   ahead of us already runs first
+    if (&otherImpl->GetQueue() == &GetQueue())
+        throw CRHIRuntimeError("Lists on the same queue already execute in enqueue order");
+    if (bIsCommitted || otherImpl->IsCommitted())
+        throw CRHIRuntimeError("Dependencies must be declared before either list is committed");
+    if (otherImpl->DependsOn(*this))
+        throw CRHIRuntimeError("Lists on different queues would wait for each other");
+
+    VkSemaphore semaphore;
+    VkSemaphoreCreateInfo semaphoreInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+    VK(vkCreateSemaphore(GetQueue().GetDevice().GetVkDevice(), &semaphoreInfo, nullptr,
+                         &semaphore));
+    otherImpl->DependencySemaphores.push_back(semaphore);
+    otherImpl->DependencySignalSemaphores.push_back(semaphore);
+    DependencyWaitSemaphores.push_back(semaphore);
+    WaitLists.push_back(std::move(otherImpl));
+}
+
+bool CCommandListVk::AreDependenciesSubmitted() const
+{
+    for (const auto& list : WaitLists)
+        if (!list->IsSubmitted())
+            return false;
+    return true;
+}
+
+bool CCommandListVk::DependsOn(const CCommandListVk& target) const
+{
+    // Every list runs after the ones it waits for and the ones enqueued ahead of it
+    std::vector<const CCommandListVk*> stack { this };
+    std::unordered_set<const CCommandListVk*> visited;
+    std::vector<CCommandListVk::Ref> ahead;
+    while (!stack.empty())
+    {
+        const CCommandListVk* list = stack.back();
+        stack.pop_back();
+        if (list->IsSubmitted() || !visited.insert(list).second)
+            continue;
+        for (const auto& waitList : list->WaitLists)
+        {
+            if (waitList.get() == &target)
+                return true;
+            stack.push_back(waitList.get());
+        }
+        // Held alive by the queue, the lists only leave it once submitted
+        list->GetQueue().GetListsAhead(*list, ahead);
+        for (const auto& aheadList : ahead)
+        {
+            if (aheadList.get() == &target)
+                return true;
+            stack.push_back(aheadList.get());
+        }
+    }
+    return false;
+}
+
 ICopyContext::Ref CCommandListVk::CreateCopyContext()
 {
     return std::make_shared<CCommandContextVk>(
@@ -72,8 +145,29 @@ CCommandListVk::CreateParallelRenderContext(CRenderPass::Ref renderPass,
 void CCommandListVk::MakeSubmitInfos(std::vector<VkSubmitInfo>& submitInfos,
                                      std::vector<VkCommandBuffer>& stagingArray)
 {
+    // Nothing recorded, but we still need a batch to carry the dependency semaphores
+    if (Sections.empty()
+        && (!DependencyWaitSemaphores.empty() || !DependencySignalSemaphores.empty()))
+    {
+        CCommandListSection section;
+        section.CmdBuffer = GetQueue().GetCmdBufferAllocator().Allocate();
+        section.CmdBuffer->BeginRecording(VK_NULL_HANDLE, 0);
+        section.CmdBuffer->EndRecording();
+        Sections.emplace_back(std::move(section));
+    }
+
     if (!Sections.empty())
     {
+        // The first section waits for the producers, the last one signals the consumers
+        for (VkSemaphore semaphore : DependencyWaitSemaphores)
+        {
+            Sections.front().WaitSemaphores.push_back(semaphore);
+            Sections.front().WaitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        }
+        auto& signalSemaphores = Sections.back().SignalSemaphores;
+        signalSemaphores.insert(signalSemaphores.end(), DependencySignalSemaphores.begin(),
+                                DependencySignalSemaphores.end());
+
         assert(Sections[0].PreCmdBuffer == nullptr);
         Sections[0].PreCmdBuffer = GetQueue().GetCmdBufferAllocator().Allocate();
         Sections[0].PreCmdBuffer->BeginRecording(VK_NULL_HANDLE, 0);
@@ -84,6 +178,10 @@ void CCommandListVk::MakeSubmitInfos(std::vector<VkSubmitInfo>& submitInfos,
 
     for (const auto& iter : Sections)
         submitInfos.emplace_back(iter.MakeSubmitInfo(stagingArray));
+
+    DependencyWaitSemaphores.clear();
+    DependencySignalSemaphores.clear();
+    WaitLists.clear();
 }
 
 void CCommandListVk::ReleaseAllResources() { Sections.clear(); }
@@ -5,12 +5,15 @@
 #include "CopyContext.h"
 #include "RenderContext.h"
 #include "VkCommon.h"
+#include <atomic>
 #include <memory>
 #include <vector>
 
 namespace RHI
 {
 
+class CRenderBundleVk;
+
 // A command list of made up from multiple sections (copy pass, compute pass, etc)
 struct CCommandListSection
 {
@@ -20,6 +23,8 @@ struct CCommandListSection
     std::unique_ptr<CCommandBufferVk> PreCmdBuffer;
     std::unique_ptr<CCommandBufferVk> CmdBuffer;
     std::vector<std::unique_ptr<CCommandBufferVk>> SecondaryBuffers;
+    // Bundles executed in this section, kept alive until the GPU is done with them
+    std::vector<std::shared_ptr<CRenderBundleVk>> Bundles;
 
     std::vector<VkSemaphore> SignalSemaphores;
 
@@ -37,13 +42,21 @@ public:
     typedef std::shared_ptr<CCommandListVk> Ref;
 
     explicit CCommandListVk(CCommandQueueVk& p);
+    ~CCommandListVk() override;
 
     CCommandQueueVk& GetQueue() const { return Parent; }
     bool IsQueued() const { return bIsQueued; }
     bool IsCommitted() const { return bIsCommitted; }
+    bool IsSubmitted() const { return bIsSubmitted; }
+    // Whether every list we wait for has been handed to its VkQueue
+    bool AreDependenciesSubmitted() const;
+    // Whether this list has to wait for target, directly or through the order of the queues
+    bool DependsOn(const CCommandListVk& target) const;
+    const std::vector<CCommandListVk::Ref>& GetWaitLists() const { return WaitLists; }
 
     void Enqueue() override;
     void Commit() override;
+    void WaitFor(CCommandList::Ref other) override;
 
     ICopyContext::Ref CreateCopyContext() override;
     IComputeContext::Ref CreateComputeContext() override;
@@ -54,6 +67,8 @@ public:
     void MakeSubmitInfos(std::vector<VkSubmitInfo>& submitInfos,
                          std::vector<VkCommandBuffer>& stagingArray);
     void ReleaseAllResources();
+    // Called by the queue right after vkQueueSubmit
+    void MarkSubmitted() { bIsSubmitted = true; }
 
 private:
     // Not holding a reference to prevent circular reference
@@ -62,6 +77,15 @@ private:
     bool bIsQueued = false;
     // Whether this command list is ready for submission
     bool bIsCommitted = false;
+    // Whether this command list has been submitted, read by other queues' threads
+    std::atomic<bool> bIsSubmitted { false };
+
+    // Cross queue dependencies. The semaphores are owned by the signaling list, the waiting list
+    //   keeps that alive until it's batched
+    std::vector<VkSemaphore> DependencySemaphores;
+    std::vector<CCommandListVk::Ref> WaitLists;
+    std::vector<VkSemaphore> DependencyWaitSemaphores;
+    std::vector<VkSemaphore> DependencySignalSemaphores;
 
     // The context has access to all the temporary states
     // NOTE: Sections[0].AccessTracker tracks the entire command list
@@ -1,4 +1,5 @@
 #include "CommandQueueVk.h"
+#include "CommandContextVk.h"
 #include "CommandListVk.h"
 #include "DeviceVk.h"
 
@@ -16,19 +17,37 @@ CCommandQueueVk::CCommandQueueVk(CDeviceVk& p, EQueueType queueType, VkQueue han
     VK(vkResetFences(Parent.GetVkDevice(), 1, &FrameResources[0].Fence));
 }
 
-CCommandQueueVk::~CCommandQueueVk() { Finish(); }
+CCommandQueueVk::~CCommandQueueVk()
+{
+    Finish();
+    for (const auto& marker : Markers)
+        vkDestroyFence(Parent.GetVkDevice(), marker.second, nullptr);
+    for (VkFence fence : FreeMarkers)
+        vkDestroyFence(Parent.GetVkDevice(), fence, nullptr);
+}
 
 CCommandList::Ref CCommandQueueVk::CreateCommandList()
 {
     return std::make_shared<CCommandListVk>(*this);
 }
 
-void CCommandQueueVk::Flush() { Submit(); }
+CRenderBundle::Ref CCommandQueueVk::CreateRenderBundle(CRenderPass::Ref renderPass,
+                                                       uint32_t subpass)
+{
+    return std::make_shared<CRenderBundleVk>(*this, std::move(renderPass), subpass);
+}
+
+void CCommandQueueVk::Flush()
+{
+    Submit();
+    CheckBlockedList(false);
+}
 
 void CCommandQueueVk::Finish()
 {
     Flush();
-    vkQueueWaitIdle(GetHandle());
+    // Also releases the lists that were submitted outside of frames
+    Wait(Signal());
 }
 
 void CCommandQueueVk::EnqueueCommandList(CCommandListVk::Ref cmdList)
@@ -37,8 +56,12 @@ void CCommandQueueVk::EnqueueCommandList(CCommandListVk::Ref cmdList)
     QueuedLists.push_back(std::move(cmdList));
 }
 
-void CCommandQueueVk::Submit(bool setFence)
+size_t CCommandQueueVk::Submit(bool setFence)
 {
+    // Pending uploads go first, so whatever is submitted now can use the data
+    if (auto* uploads = Parent.GetUploadManager())
+        uploads->Flush();
+
     std::lock_guard<std::mutex> lk(Mutex);
 
     // Try to submit all queued lists that are committed
@@ -48,47 +71,121 @@ void CCommandQueueVk::Submit(bool setFence)
     size_t submittedCount = 0;
     for (const auto& list : QueuedLists)
     {
-        bool ready = list->IsCommitted();
+        bool ready = list->IsCommitted() && list->AreDependenciesSubmitted();
         if (ready)
         {
             list->MakeSubmitInfos(submitInfos, cmdBufferStaging);
-
-            // Move this list to the in flight list
-            FrameResources[CurrFrameIndex].ListsInFlight.emplace_back(list);
             submittedCount++;
         }
         else
             break;
     }
 
-	if (submittedCount == 0)
-        return;
+    // The frame fence goes out even without lists, SubmitFrame waits for it later
+    if (submittedCount == 0 && !setFence)
+        return 0;
 
-    QueuedLists.erase(QueuedLists.begin(), QueuedLists.begin() + submittedCount);
     if (cmdBufferStaging.size() > 512)
         throw CRHIException("Umm, tell Toby about this");
+
     if (setFence)
-        VK(vkQueueSubmit(GetHandle(), static_cast<uint32_t>(submitInfos.size()), submitInfos.data(),
-                         FrameResources[CurrFrameIndex].Fence));
-    else
-        VK(vkQueueSubmit(GetHandle(), static_cast<uint32_t>(submitInfos.size()), submitInfos.data(),
-                         VK_NULL_HANDLE));
+        bDrivesFrames = true;
+    {
+        std::lock_guard<std::mutex> lkq(Parent.GetVkQueueMutex(GetHandle()));
+        if (setFence)
+            VK(vkQueueSubmit(GetHandle(), static_cast<uint32_t>(submitInfos.size()),
+                             submitInfos.data(), FrameResources[CurrFrameIndex].Fence));
+        else
+            VK(vkQueueSubmit(GetHandle(), static_cast<uint32_t>(submitInfos.size()),
+                             submitInfos.data(), VK_NULL_HANDLE));
+    }
+
+    SubmitCount++;
+
+    // Move the lists in flight, only now can lists on other queues wait for them
+    std::lock_guard<std::mutex> lkm(MarkerMutex);
+    for (size_t i = 0; i < submittedCount; i++)
+    {
+        QueuedLists[i]->MarkSubmitted();
+        if (bDrivesFrames)
+            FrameResources[CurrFrameIndex].ListsInFlight.emplace_back(std::move(QueuedLists[i]));
+        else
+            MarkedLists.emplace_back(SubmitCount, std::move(QueuedLists[i]));
+    }
+    QueuedLists.erase(QueuedLists.begin(), QueuedLists.begin() + submittedCount);
+
+    if (!bDrivesFrames)
+    {
+        PushMarker();
+        RetireMarkers();
+    }
+    return submittedCount;
+}
+
+void CCommandQueueVk::SubmitImmediately(CCommandListVk& cmdList, VkFence fence)
+{
+    // Under the queue lock so the image states the list deploys stay in submission order
+    std::lock_guard<std::mutex> lk(Mutex);
 
-    std::lock_guard<std::mutex> lkd(GetDevice().DeviceMutex);
-    auto& fnList = FrameResources[CurrFrameIndex].PostFrameCleanup;
-    fnList.insert(fnList.end(), GetDevice().PostFrameCleanup.begin(),
-                  GetDevice().PostFrameCleanup.end());
-    GetDevice().PostFrameCleanup.clear();
+    std::vector<VkCommandBuffer> cmdBufferStaging;
+    cmdBufferStaging.reserve(512);
+    std::vector<VkSubmitInfo> submitInfos;
+    cmdList.MakeSubmitInfos(submitInfos, cmdBufferStaging);
+    {
+        std::lock_guard<std::mutex> lkq(Parent.GetVkQueueMutex(GetHandle()));
+        VK(vkQueueSubmit(GetHandle(), static_cast<uint32_t>(submitInfos.size()),
+                         submitInfos.data(), fence));
+    }
+    SubmitCount++;
+    cmdList.MarkSubmitted();
 }
 
 void CCommandQueueVk::SubmitFrame()
 {
+    // Constants and transient data have to be flushed before the GPU can see them
+    GetDevice().GetHugeConstantBuffer()->MarkBlockEnd();
+    GetDevice().GetTransientBuffer()->MarkBlockEnd();
+
+    // Lists may wait for lists on the other queues and the other way around, so keep going
+    //   around until nothing moves
+    auto queues = GetDevice().GetCommandQueues();
+    size_t submittedCount;
+    do
+    {
+        submittedCount = 0;
+        for (const auto& queue : queues)
+            if (queue.get() != this)
+                submittedCount += queue->Submit();
+        submittedCount += Submit();
+    } while (submittedCount > 0);
+    for (const auto& queue : queues)
+        queue->CheckBlockedList(true);
+
     // Do Submit() and advance frame index
     Submit(true);
 
-    GetDevice().GetHugeConstantBuffer()->MarkBlockEnd();
+    // Lists on other queues may use anything this frame retires, so it waits for them too
+    auto& frame = FrameResources[CurrFrameIndex];
+    for (const auto& queue : queues)
+        if (queue.get() != this)
+            frame.OtherQueues.emplace_back(queue, queue->Signal());
+    {
+        std::lock_guard<std::mutex> lkd(GetDevice().DeviceMutex);
+        frame.PostFrameCleanup.insert(frame.PostFrameCleanup.end(),
+                                      GetDevice().PostFrameCleanup.begin(),
+                                      GetDevice().PostFrameCleanup.end());
+        GetDevice().PostFrameCleanup.clear();
+    }
+
     FrameResources[CurrFrameIndex].PostFrameCleanup.emplace_back(
         [](CDeviceVk& p) { p.GetHugeConstantBuffer()->FreeBlock(); });
+    FrameResources[CurrFrameIndex].PostFrameCleanup.emplace_back(
+        [](CDeviceVk& p) { p.GetTransientBuffer()->FreeBlock(); });
+    GetDevice().GetDescriptorSetCache()->NextFrame();
+    uint64_t descriptorFrame = GetDevice().GetTransientDescriptorPool()->NextFrame();
+    FrameResources[CurrFrameIndex].PostFrameCleanup.emplace_back([descriptorFrame](CDeviceVk& p) {
+        p.GetTransientDescriptorPool()->ResetFrame(descriptorFrame);
+    });
 
     // Advance
     CurrFrameIndex++;
@@ -115,6 +212,11 @@ CCommandQueueVk::CFrameResources::~CFrameResources()
 
 void CCommandQueueVk::CFrameResources::Reset()
 {
+    for (const auto& queue : OtherQueues)
+        if (auto ref = queue.first.lock())
+            ref->Wait(queue.second);
+    OtherQueues.clear();
+
     for (const auto& ptr : ListsInFlight)
         ptr->ReleaseAllResources();
     for (const auto& cleanupFn : PostFrameCleanup)
@@ -123,4 +225,108 @@ void CCommandQueueVk::CFrameResources::Reset()
     PostFrameCleanup.clear();
 }
 
+uint64_t CCommandQueueVk::Signal()
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    std::lock_guard<std::mutex> lkm(MarkerMutex);
+    uint64_t value = SubmitCount;
+    // Nothing submitted since the last marker, it covers this value too
+    if (value <= CompletedValue || (!Markers.empty() && Markers.back().first == value))
+        return value;
+
+    PushMarker();
+    return value;
+}
+
+bool CCommandQueueVk::IsComplete(uint64_t value)
+{
+    std::lock_guard<std::mutex> lk(MarkerMutex);
+    RetireMarkers();
+    return value <= CompletedValue;
+}
+
+void CCommandQueueVk::Wait(uint64_t value)
+{
+    std::lock_guard<std::mutex> lk(MarkerMutex);
+    RetireMarkers(value);
+}
+
+void CCommandQueueVk::GetListsAhead(const CCommandListVk& list,
+                                    std::vector<CCommandListVk::Ref>& result)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    result.clear();
+    for (const auto& queued : QueuedLists)
+    {
+        if (queued.get() == &list)
+            return;
+        result.push_back(queued);
+    }
+}
+
+void CCommandQueueVk::CheckBlockedList(bool bEndOfFrame)
+{
+    CCommandListVk::Ref blocked;
+    {
+        std::lock_guard<std::mutex> lk(Mutex);
+        if (QueuedLists.empty() || !QueuedLists.front()->IsCommitted())
+            return;
+        blocked = QueuedLists.front();
+    }
+
+    for (const auto& producer : blocked->GetWaitLists())
+    {
+        if (producer->IsSubmitted())
+            continue;
+        if (producer->DependsOn(*blocked))
+            throw CRHIRuntimeError("Lists on different queues wait for each other");
+        if (bEndOfFrame)
+            throw CRHIRuntimeError("A list waits for a list that couldn't be submitted this frame");
+    }
+}
+
+void CCommandQueueVk::RetireMarkers(uint64_t waitValue)
+{
+    while (!Markers.empty())
+    {
+        VkFence fence = Markers.front().second;
+        if (Markers.front().first <= waitValue)
+            VK(vkWaitForFences(Parent.GetVkDevice(), 1, &fence, VK_TRUE, UINT64_MAX));
+        else if (vkGetFenceStatus(Parent.GetVkDevice(), fence) != VK_SUCCESS)
+            break;
+
+        VK(vkResetFences(Parent.GetVkDevice(), 1, &fence));
+        FreeMarkers.push_back(fence);
+        CompletedValue = Markers.front().first;
+        Markers.pop_front();
+    }
+
+    while (!MarkedLists.empty() && MarkedLists.front().first <= CompletedValue)
+    {
+        MarkedLists.front().second->ReleaseAllResources();
+        MarkedLists.pop_front();
+    }
+}
+
+void CCommandQueueVk::PushMarker()
+{
+    VkFence fence;
+    if (!FreeMarkers.empty())
+    {
+        fence = FreeMarkers.back();
+        FreeMarkers.pop_back();
+    }
+    else
+    {
+        VkFenceCreateInfo fenceInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+        VK(vkCreateFence(Parent.GetVkDevice(), &fenceInfo, nullptr, &fence));
+    }
+    {
+        // An empty submission signals once all earlier work on the VkQueue is done
+        std::lock_guard<std::mutex> lkq(Parent.GetVkQueueMutex(GetHandle()));
+        VK(vkQueueSubmit(GetHandle(), 0, nullptr, fence));
+    }
+    Markers.emplace_back(SubmitCount, fence);
+}
+
 }
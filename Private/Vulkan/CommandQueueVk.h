@@ -5,6 +5,7 @@
 #include "VkCommon.h"
 #include <SpinLock.h>
 #include <array>
+#include <deque>
 #include <mutex>
 #include <vector>
 
@@ -25,6 +26,7 @@ public:
     CCommandBufferAllocatorVk& GetCmdBufferAllocator() { return CmdBufferAllocator; }
 
     CCommandList::Ref CreateCommandList() override;
+    CRenderBundle::Ref CreateRenderBundle(CRenderPass::Ref renderPass, uint32_t subpass) override;
 
     void Flush() override;
     void Finish() override;
@@ -32,12 +34,36 @@ public:
     // Reserve a spot for the command list in this queue
     void EnqueueCommandList(CCommandListVk::Ref cmdList);
 
-    // Submit all committed command lists
-    void Submit(bool setFence = false);
-    // Submit and advance frame index
+    // Submit all committed command lists, returns how many. Queues that don't drive frames with
+    //   SubmitFrame retire the lists on fences of their own, polled whenever they submit again
+    size_t Submit(bool setFence = false);
+    // Submit a finished list that was never enqueued right away, ahead of anything still queued.
+    //   For internal work that doesn't wait on other lists, the caller keeps it alive until the
+    //   fence is signaled
+    void SubmitImmediately(CCommandListVk& cmdList, VkFence fence);
+    // Submit and advance frame index. The frame also waits on every other queue before its
+    //   cleanup runs, they may be using its constants, transient data and descriptor sets
     void SubmitFrame();
 
+    // Completion values count the submissions made so far. Signal returns one that completes
+    //   once everything submitted up to now has, so single results can be waited on without
+    //   draining the queue like Finish does
+    uint64_t Signal();
+    bool IsComplete(uint64_t value);
+    void Wait(uint64_t value);
+
+    // Lists enqueued ahead of list and not yet submitted, or all of them if it isn't enqueued
+    void GetListsAhead(const CCommandListVk& list, std::vector<CCommandListVk::Ref>& result);
+
 private:
+    // Throws if the committed list holding the queue back can never be submitted. At the end of
+    //   a frame it mustn't wait at all, the frame's constants would be gone by the time it runs
+    void CheckBlockedList(bool bEndOfFrame);
+    // Needs MarkerMutex held, waits for the markers up to `waitValue` and polls the rest
+    void RetireMarkers(uint64_t waitValue = 0);
+    // Needs Mutex and MarkerMutex held, adds a marker for everything submitted so far
+    void PushMarker();
+
     CDeviceVk& Parent;
     EQueueType Type;
     VkQueue Handle = VK_NULL_HANDLE;
@@ -46,6 +72,18 @@ private:
     std::mutex Mutex;
 
     std::vector<CCommandListVk::Ref> QueuedLists;
+    // Under Mutex
+    uint64_t SubmitCount = 0;
+    // Set once SubmitFrame is used, lists then stay in flight until their frame comes around
+    bool bDrivesFrames = false;
+
+    // Fences submitted by Signal or along with lists, oldest first
+    std::mutex MarkerMutex;
+    std::deque<std::pair<uint64_t, VkFence>> Markers;
+    std::vector<VkFence> FreeMarkers;
+    uint64_t CompletedValue = 0;
+    // Lists submitted outside of frames, released once their marker has passed
+    std::deque<std::pair<uint64_t, CCommandListVk::Ref>> MarkedLists;
 
     static const uint32_t FrameIndexCount = 3;
     struct CFrameResources
@@ -55,6 +93,8 @@ private:
 
         std::vector<CCommandListVk::Ref> ListsInFlight;
         std::vector<std::function<void(CDeviceVk&)>> PostFrameCleanup;
+        // Where the other queues were when the frame was submitted
+        std::vector<std::pair<std::weak_ptr<CCommandQueueVk>, uint64_t>> OtherQueues;
 
         CFrameResources(CDeviceVk& deviceVk);
         ~CFrameResources();
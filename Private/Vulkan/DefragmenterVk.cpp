@@ -0,0 +1,132 @@
+#include "DefragmenterVk.h"
+#include "DeviceVk.h"
+#include <functional>
+#include <vector>
+
+namespace RHI
+{
+
+namespace
+{
+
+// On the render queue, ahead of anything still queued. Everything submitted before has retired
+//   once this returns
+void SubmitAndWait(CDeviceVk& device, const std::function<void(VkCommandBuffer)>& record)
+{
+    auto queue = device.GetDefaultRenderQueue();
+    auto list = std::static_pointer_cast<CCommandListVk>(queue->CreateCommandList());
+    auto ctx = std::static_pointer_cast<CCommandContextVk>(list->CreateCopyContext());
+    record(ctx->GetCmdBuffer());
+    ctx->FinishRecording();
+    ctx.reset();
+
+    queue->SubmitImmediately(*list, VK_NULL_HANDLE);
+    queue->Wait(queue->Signal());
+    list->ReleaseAllResources();
+}
+
+}
+
+CDefragmenterVk::CDefragmenterVk(CDeviceVk& p)
+    : Parent(p)
+{
+}
+
+void CDefragmenterVk::Register(CBufferVk* buffer, VmaAllocation allocation)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    Movables[allocation] = buffer;
+    Buffers.insert(buffer);
+}
+
+void CDefragmenterVk::Unregister(VmaAllocation allocation)
+{
+    // Waits out a step that may be moving it right now
+    std::lock_guard<std::mutex> lk(Mutex);
+    auto iter = Movables.find(allocation);
+    if (iter == Movables.end())
+        return;
+    Buffers.erase(iter->second);
+    Movables.erase(iter);
+}
+
+VkBuffer CDefragmenterVk::GetBufferHandle(const CBufferVk* buffer, VkBuffer handle)
+{
+    // Buffers unregister before they're destroyed, so a registered one is safe to look at
+    std::lock_guard<std::mutex> lk(Mutex);
+    if (Buffers.find(buffer) == Buffers.end())
+        return handle;
+    return buffer->GetHandle();
+}
+
+CDefragmentStats CDefragmenterVk::Step(const CDefragmentOptions& options)
+{
+    CDefragmentStats stats;
+    stats.FragmentationBefore = Parent.GetMemoryStats().Fragmentation;
+    stats.FragmentationAfter = stats.FragmentationBefore;
+
+    // Batched uploads were recorded against the current handles, they go ahead of the copies
+    Parent.FlushUploads();
+    // The copies only wait on the render queue, lists on the others may still read the old places
+    for (const auto& queue : Parent.GetCommandQueues())
+    {
+        queue->Flush();
+        queue->Wait(queue->Signal());
+    }
+
+    std::lock_guard<std::mutex> lk(Mutex);
+    std::vector<VmaAllocation> allocations;
+    allocations.reserve(Movables.size());
+    for (const auto& pair : Movables)
+        allocations.push_back(pair.first);
+    if (allocations.empty())
+        return stats;
+    std::vector<VkBool32> moved(allocations.size(), VK_FALSE);
+
+    // Nothing may allocate from VMA on this thread until the context ends
+    VmaDefragmentationStats vmaStats = {};
+    VmaDefragmentationContext context = VK_NULL_HANDLE;
+    SubmitAndWait(Parent, [&](VkCommandBuffer cmdBuffer) {
+        // Earlier frames may still be using what is about to be overwritten
+        VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                             nullptr);
+
+        // Host visible memory is never registered, so everything moves with GPU copies
+        VmaDefragmentationInfo2 info = {};
+        info.allocationCount = static_cast<uint32_t>(allocations.size());
+        info.pAllocations = allocations.data();
+        info.pAllocationsChanged = moved.data();
+        info.maxGpuBytesToMove = options.MaxBytesToMove;
+        info.maxGpuAllocationsToMove = options.MaxAllocationsToMove;
+        info.commandBuffer = cmdBuffer;
+        if (vmaDefragmentationBegin(Parent.GetAllocator(), &info, &vmaStats, &context) < 0)
+            throw CRHIRuntimeError("Could not begin defragmentation");
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                             nullptr);
+    });
+    VK(vmaDefragmentationEnd(Parent.GetAllocator(), context));
+
+    // The old handles are still bound to the old places
+    for (size_t i = 0; i < allocations.size(); i++)
+        if (moved[i])
+            Movables.at(allocations[i])->Rebind();
+
+    if (vmaStats.allocationsMoved > 0)
+        Generation++;
+    stats.BytesMoved = vmaStats.bytesMoved;
+    stats.BytesFreed = vmaStats.bytesFreed;
+    stats.AllocationsMoved = vmaStats.allocationsMoved;
+    stats.BlocksFreed = vmaStats.deviceMemoryBlocksFreed;
+    stats.FragmentationAfter = Parent.GetMemoryStats().Fragmentation;
+    return stats;
+}
+
+} /* namespace RHI */
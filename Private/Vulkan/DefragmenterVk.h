@@ -0,0 +1,42 @@
+#pragma once
+#include "Resources.h"
+#include "VkCommon.h"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace RHI
+{
+
+// Moves GPU only buffers around with VMA's defragmentation, recreating their handles in place.
+//   Descriptor sets notice through GetGeneration and pick up the new handles the next time
+//   they're bound. Render bundles don't, the handles are baked into their command buffers when
+//   recorded. Images are never moved: an optimal tiling image recreated over moved memory isn't
+//   guaranteed to read back the same
+class CDefragmenterVk
+{
+public:
+    explicit CDefragmenterVk(CDeviceVk& p);
+
+    // Safe to call from any thread
+    void Register(CBufferVk* buffer, VmaAllocation allocation);
+    void Unregister(VmaAllocation allocation);
+    // Where buffer lives now, or handle if it was never registered or is gone. Doesn't keep the
+    //   buffer alive, it's only looked at while registered
+    VkBuffer GetBufferHandle(const CBufferVk* buffer, VkBuffer handle);
+
+    CDefragmentStats Step(const CDefragmentOptions& options);
+
+    // Bumped whenever a step has moved something
+    uint64_t GetGeneration() const { return Generation.load(); }
+
+private:
+    CDeviceVk& Parent;
+    std::mutex Mutex;
+    std::unordered_map<VmaAllocation, CBufferVk*> Movables;
+    std::unordered_set<const CBufferVk*> Buffers;
+    std::atomic<uint64_t> Generation { 0 };
+};
+
+} /* namespace RHI */
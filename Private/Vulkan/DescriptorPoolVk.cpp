@@ -29,6 +29,10 @@ namespace RHI
 CDescriptorPoolVk::CDescriptorPoolVk(const CDescriptorSetLayoutVk* layout)
     : Layout(layout)
 {
+    // Bindless layouts are huge and there is usually only one set of them
+    if (layout->IsUpdateAfterBind())
+        MaxSetsPerPool = 1;
+
     // Get the layout's binding information.
     const auto& bindings = layout->GetBindings();
 
@@ -87,6 +91,8 @@ VkDescriptorSet CDescriptorPoolVk::AllocateDescriptorSet()
             VkDescriptorPoolCreateInfo createInfo = {};
             createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
             createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+            if (Layout->IsUpdateAfterBind())
+                createInfo.flags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
             createInfo.poolSizeCount = static_cast<uint32_t>(PoolSizes.size());
             createInfo.pPoolSizes = PoolSizes.data();
             createInfo.maxSets = MaxSetsPerPool;
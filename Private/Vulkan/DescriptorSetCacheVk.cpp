@@ -0,0 +1,164 @@
+#include "DescriptorSetCacheVk.h"
+#include "DeviceVk.h"
+#include <Hash.h>
+#include <algorithm>
+
+namespace RHI
+{
+
+void CDescriptorSetKey::Finalize()
+{
+    std::sort(Elements.begin(), Elements.end(), [](const CElement& a, const CElement& b) {
+        return a.Binding < b.Binding || (a.Binding == b.Binding && a.ArrayElement < b.ArrayElement);
+    });
+
+    Hash = 0;
+    tc::hash_combine(Hash, reinterpret_cast<size_t>(Layout));
+    for (const auto& e : Elements)
+    {
+        tc::hash_combine(Hash, e.Binding);
+        tc::hash_combine(Hash, e.ArrayElement);
+        tc::hash_combine(Hash, e.Handle);
+        tc::hash_combine(Hash, e.Offset);
+        tc::hash_combine(Hash, e.Range);
+        tc::hash_combine(Hash, static_cast<uint32_t>(e.ImageLayout));
+    }
+}
+
+CDescriptorSetCacheVk::CDescriptorSetCacheVk(CDeviceVk& p)
+    : Parent(p)
+{
+}
+
+// The pools own the sets and free them on their own
+CDescriptorSetCacheVk::~CDescriptorSetCacheVk() = default;
+
+VkDescriptorSet CDescriptorSetCacheVk::Acquire(const CDescriptorSetLayoutVk::Ref& layout,
+                                               const CDescriptorSetKey& key,
+                                               const std::function<void(VkDescriptorSet)>& write)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+
+    auto iter = Lookup.find(key);
+    if (iter != Lookup.end())
+    {
+        auto& entry = Entries.at(iter->second);
+        if (entry.UserCount++ == 0)
+            Unused.erase(entry.UnusedIter);
+        entry.LastUsedFrame = CurrFrame;
+        return iter->second;
+    }
+
+    // Written under the lock so nobody else can pick up a half written set
+    VkDescriptorSet handle = layout->GetDescriptorPool()->AllocateDescriptorSet();
+    if (!handle)
+        throw CRHIRuntimeError("Descriptor set allocation failed");
+    write(handle);
+
+    auto& entry = Entries[handle];
+    entry.Layout = layout;
+    entry.Key = key;
+    entry.UserCount = 1;
+    entry.LastUsedFrame = CurrFrame;
+    Lookup.emplace(key, handle);
+    Index(handle, entry);
+    return handle;
+}
+
+void CDescriptorSetCacheVk::Release(VkDescriptorSet handle)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+
+    auto iter = Entries.find(handle);
+    if (iter == Entries.end())
+        return;
+    auto& entry = iter->second;
+    assert(entry.UserCount > 0);
+    entry.UserCount--;
+    entry.LastUsedFrame = CurrFrame;
+    if (entry.UserCount > 0)
+        return;
+    if (entry.bInLookup)
+        entry.UnusedIter = Unused.insert(Unused.end(), handle);
+    else
+    {
+        Free(iter->first, entry);
+        Entries.erase(iter);
+    }
+}
+
+void CDescriptorSetCacheVk::Evict(uint64_t resourceHandle)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+
+    auto resourceIter = ByResource.find(resourceHandle);
+    if (resourceIter == ByResource.end())
+        return;
+    auto handles = std::move(resourceIter->second);
+    ByResource.erase(resourceIter);
+
+    for (VkDescriptorSet handle : handles)
+    {
+        auto iter = Entries.find(handle);
+        auto& entry = iter->second;
+        Lookup.erase(entry.Key);
+        Unindex(handle, entry);
+        entry.bInLookup = false;
+        if (entry.UserCount == 0)
+        {
+            Unused.erase(entry.UnusedIter);
+            Free(handle, entry);
+            Entries.erase(iter);
+        }
+    }
+}
+
+void CDescriptorSetCacheVk::NextFrame()
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+
+    CurrFrame++;
+    // Released in frame order, so stop at the first one still young enough
+    while (!Unused.empty())
+    {
+        auto iter = Entries.find(Unused.front());
+        auto& entry = iter->second;
+        if (CurrFrame - entry.LastUsedFrame <= MaxUnusedFrames)
+            break;
+        Unused.pop_front();
+        Lookup.erase(entry.Key);
+        Unindex(iter->first, entry);
+        Free(iter->first, entry);
+        Entries.erase(iter);
+    }
+}
+
+void CDescriptorSetCacheVk::Free(VkDescriptorSet handle, const CEntry& entry)
+{
+    // Command buffers in flight may still reference it
+    auto l = entry.Layout;
+    Parent.AddPostFrameCleanup(
+        [l, handle](CDeviceVk& p) { l->GetDescriptorPool()->FreeDescriptorSet(handle); });
+}
+
+void CDescriptorSetCacheVk::Index(VkDescriptorSet handle, const CEntry& entry)
+{
+    for (const auto& e : entry.Key.Elements)
+        if (e.Handle)
+            ByResource[e.Handle].insert(handle);
+}
+
+void CDescriptorSetCacheVk::Unindex(VkDescriptorSet handle, const CEntry& entry)
+{
+    for (const auto& e : entry.Key.Elements)
+    {
+        auto iter = ByResource.find(e.Handle);
+        if (iter == ByResource.end())
+            continue;
+        iter->second.erase(handle);
+        if (iter->second.empty())
+            ByResource.erase(iter);
+    }
+}
+
+}
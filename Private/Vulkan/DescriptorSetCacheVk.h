@@ -0,0 +1,109 @@
+#pragma once
+#include "DescriptorSetLayoutVk.h"
+#include "VkCommon.h"
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace RHI
+{
+
+// What a descriptor set looks like to the GPU, two sets with equal keys are interchangeable
+struct CDescriptorSetKey
+{
+    struct CElement
+    {
+        uint32_t Binding;
+        uint32_t ArrayElement;
+        // VkBuffer, VkImageView or VkSampler
+        uint64_t Handle;
+        VkDeviceSize Offset;
+        VkDeviceSize Range;
+        VkImageLayout ImageLayout;
+
+        bool operator==(const CElement& r) const
+        {
+            return Binding == r.Binding && ArrayElement == r.ArrayElement && Handle == r.Handle
+                && Offset == r.Offset && Range == r.Range && ImageLayout == r.ImageLayout;
+        }
+    };
+
+    const CDescriptorSetLayoutVk* Layout = nullptr;
+    // Sorted by binding then array element
+    std::vector<CElement> Elements;
+    size_t Hash = 0;
+
+    // Sorts the elements and computes the hash
+    void Finalize();
+
+    bool operator==(const CDescriptorSetKey& r) const
+    {
+        return Hash == r.Hash && Layout == r.Layout && Elements == r.Elements;
+    }
+};
+
+// Non-dispatchable handles are pointers or uint64_t depending on the platform
+template <typename T> uint64_t GetHandleKey(T handle) { return (uint64_t)(handle); }
+
+struct CDescriptorSetKeyHash
+{
+    size_t operator()(const CDescriptorSetKey& key) const { return key.Hash; }
+};
+
+// Shares immutable VkDescriptorSets between descriptor sets with identical contents
+//   Sets nobody holds on to are kept around for a few frames in case the contents come back
+class CDescriptorSetCacheVk
+{
+public:
+    explicit CDescriptorSetCacheVk(CDeviceVk& p);
+    ~CDescriptorSetCacheVk();
+
+    // Returns a set matching the key, calling write to fill in a newly allocated one on a miss
+    //   Every Acquire must be paired with a Release
+    VkDescriptorSet Acquire(const CDescriptorSetLayoutVk::Ref& layout, const CDescriptorSetKey& key,
+                            const std::function<void(VkDescriptorSet)>& write);
+    void Release(VkDescriptorSet handle);
+
+    // Drop every set that points at a resource being destroyed
+    void Evict(uint64_t resourceHandle);
+
+    // Frees the sets that have been unused for too long, called once per frame
+    void NextFrame();
+
+private:
+    struct CEntry
+    {
+        CDescriptorSetLayoutVk::Ref Layout;
+        CDescriptorSetKey Key;
+        uint32_t UserCount = 0;
+        uint64_t LastUsedFrame = 0;
+        // False once evicted, the set is freed when the last user releases it
+        bool bInLookup = true;
+        // Position in Unused, only valid while nobody holds the set
+        std::list<VkDescriptorSet>::iterator UnusedIter;
+    };
+
+    void Free(VkDescriptorSet handle, const CEntry& entry);
+    // Keep ByResource in step with Lookup
+    void Index(VkDescriptorSet handle, const CEntry& entry);
+    void Unindex(VkDescriptorSet handle, const CEntry& entry);
+
+    // Unused sets older than this many frames are freed
+    static const uint64_t MaxUnusedFrames = 8;
+
+    CDeviceVk& Parent;
+
+    std::mutex Mutex;
+    std::unordered_map<CDescriptorSetKey, VkDescriptorSet, CDescriptorSetKeyHash> Lookup;
+    std::unordered_map<VkDescriptorSet, CEntry> Entries;
+    // Sets in Lookup by every resource they point at, so Evict doesn't scan the whole cache
+    std::unordered_map<uint64_t, std::unordered_set<VkDescriptorSet>> ByResource;
+    // Cached sets nobody holds, oldest release first, so aging only looks at the front
+    std::list<VkDescriptorSet> Unused;
+    uint64_t CurrFrame = 0;
+};
+
+}
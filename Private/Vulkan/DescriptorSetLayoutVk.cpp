@@ -2,6 +2,7 @@
 #include "DescriptorSetVk.h"
 #include "DeviceVk.h"
 
+#include <algorithm>
 #include <unordered_map>
 
 namespace RHI
@@ -13,11 +14,9 @@ inline VkShaderStageFlags VkCast(EShaderStageFlags stageFlags)
 }
 
 CDescriptorSetLayoutVk::CDescriptorSetLayoutVk(
-    CDeviceVk& p, const std::vector<CDescriptorSetLayoutBinding>& bindings)
+    CDeviceVk& p, const std::vector<CDescriptorSetLayoutBinding>& bindings, bool bPushDescriptors)
     : Parent(p)
 {
-    // TODO: hashing and caching
-
     static const std::unordered_map<EDescriptorType, VkDescriptorType> descriptorTypeMap = {
         { EDescriptorType::Sampler, VK_DESCRIPTOR_TYPE_SAMPLER },
         { EDescriptorType::Image, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE },
@@ -40,12 +39,42 @@ CDescriptorSetLayoutVk::CDescriptorSetLayoutVk(
         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
     };
 
+    if (bPushDescriptors)
+    {
+        uint32_t descriptorCount = 0;
+        bool bHasUnbounded = false;
+        for (const auto& b : bindings)
+        {
+            descriptorCount += b.Count;
+            bHasUnbounded |= b.Count == 0;
+        }
+        bIsPushDescriptor = !bHasUnbounded && descriptorCount <= Parent.GetMaxPushDescriptors();
+    }
+
+    std::vector<VkDescriptorBindingFlagsEXT> bindingFlags;
     for (const auto& b : bindings)
     {
         VkDescriptorSetLayoutBinding vkBinding;
         vkBinding.binding = b.Binding;
-        vkBinding.descriptorCount = b.Count;
         vkBinding.descriptorType = descriptorTypeMap.at(b.Type);
+        // Push descriptors can't be dynamic, and being rewritten every time they don't need to be
+        if (bIsPushDescriptor
+            && vkBinding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+            vkBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        if (bIsPushDescriptor
+            && vkBinding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+            vkBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        vkBinding.descriptorCount = b.Count;
+        bindingFlags.push_back(0);
+        if (b.Count == 0)
+        {
+            // Unbounded arrays become big bindless tables that are written in place
+            vkBinding.descriptorCount = Parent.GetBindlessCapacity(vkBinding.descriptorType);
+            bindingFlags.back() = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+                | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+                | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+            bIsUpdateAfterBind = true;
+        }
         vkBinding.stageFlags = VkCast(b.StageFlags);
         vkBinding.pImmutableSamplers = nullptr;
         Bindings.push_back(vkBinding);
@@ -63,21 +92,100 @@ CDescriptorSetLayoutVk::CDescriptorSetLayoutVk(
         BindingToStages[b.Binding] = pipelineStages;
     }
 
+    for (const auto& pair : BindingToType)
+    {
+        if (pair.second != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+            && pair.second != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+            continue;
+        BindingToDynamicIndex[pair.first] = DynamicOffsetCount;
+        for (const auto& vkBinding : Bindings)
+            if (vkBinding.binding == pair.first)
+                DynamicOffsetCount += vkBinding.descriptorCount;
+    }
+
     VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
     layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutCreateInfo.bindingCount = static_cast<uint32_t>(Bindings.size());
     layoutCreateInfo.pBindings = Bindings.data();
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT
+    };
+    if (bIsPushDescriptor)
+        layoutCreateInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+    if (bIsUpdateAfterBind)
+    {
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+        layoutCreateInfo.pNext = &bindingFlagsInfo;
+        layoutCreateInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    }
     auto result =
         vkCreateDescriptorSetLayout(Parent.GetVkDevice(), &layoutCreateInfo, nullptr, &Handle);
     if (result != VK_SUCCESS)
         throw CRHIRuntimeError("Vulkan descriptor set layout create failed");
+
+    // BindingToType is ordered, so the slots come out in binding order
+    for (const auto& pair : BindingToType)
+    {
+        auto iter = std::find_if(Bindings.begin(), Bindings.end(),
+                                 [&](const auto& b) { return b.binding == pair.first; });
+        if (pair.first >= BindingToSlotRange.size())
+            BindingToSlotRange.resize(pair.first + 1, NoSlotRange);
+        BindingToSlotRange[pair.first] = static_cast<uint32_t>(SlotRanges.size());
+        SlotRanges.push_back({ pair.first, SlotCount, iter->descriptorCount });
+        SlotCount += iter->descriptorCount;
+    }
+
+    // Bindless sets are written one descriptor at a time and pushed sets go through
+    //   vkCmdPushDescriptorSetKHR, neither needs a template
+    if (bIsUpdateAfterBind || bIsPushDescriptor || Bindings.empty())
+        return;
+
+    std::vector<VkDescriptorUpdateTemplateEntryKHR> entries;
+    for (const auto& range : SlotRanges)
+    {
+        VkDescriptorUpdateTemplateEntryKHR entry;
+        entry.dstBinding = range.Binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = range.Count;
+        entry.descriptorType = BindingToType.at(range.Binding);
+        entry.offset = range.FirstSlot * sizeof(CDescriptorSlot);
+        entry.stride = sizeof(CDescriptorSlot);
+        entries.push_back(entry);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfoKHR templateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR
+    };
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    templateInfo.pDescriptorUpdateEntries = entries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+    templateInfo.descriptorSetLayout = Handle;
+    UpdateTemplate = Parent.CreateDescriptorUpdateTemplate(templateInfo);
 }
 
 CDescriptorSetLayoutVk::~CDescriptorSetLayoutVk()
 {
+    Parent.DestroyDescriptorUpdateTemplate(UpdateTemplate);
     vkDestroyDescriptorSetLayout(Parent.GetVkDevice(), Handle, nullptr);
 }
 
+const CDescriptorSetLayoutVk::CSlotRange*
+CDescriptorSetLayoutVk::FindSlotRange(uint32_t binding) const
+{
+    if (binding >= BindingToSlotRange.size() || BindingToSlotRange[binding] == NoSlotRange)
+        return nullptr;
+    return &SlotRanges[BindingToSlotRange[binding]];
+}
+
+uint32_t CDescriptorSetLayoutVk::GetDynamicOffsetIndex(uint32_t binding) const
+{
+    auto iter = BindingToDynamicIndex.find(binding);
+    if (iter == BindingToDynamicIndex.end())
+        throw CRHIRuntimeError("Binding does not have a dynamic descriptor type");
+    return iter->second;
+}
+
 CDescriptorSet::Ref CDescriptorSetLayoutVk::CreateDescriptorSet()
 {
     if (Bindings.empty())
@@ -92,32 +200,62 @@ const std::unique_ptr<CDescriptorPoolVk>& CDescriptorSetLayoutVk::GetDescriptorP
     if (Bindings.empty())
         throw CRHIRuntimeError("Cannot create descriptor set for an empty layout");
 
-    if (!Pool)
-        Pool = std::make_unique<CDescriptorPoolVk>(this);
+    // Layouts are shared between threads through the device's state cache
+    std::call_once(PoolOnce, [this]() { Pool = std::make_unique<CDescriptorPoolVk>(this); });
     return Pool;
 }
 
 CPipelineLayoutVk::CPipelineLayoutVk(CDeviceVk& p,
-                                     const std::vector<CDescriptorSetLayout::Ref>& setLayouts)
+                                     const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+                                     const std::vector<CPushConstantRange>& pushConstantRanges)
     : Parent(p)
 {
     assert(!setLayouts.empty());
     std::vector<VkDescriptorSetLayout> vkLayouts;
+    uint32_t pushDescriptorSets = 0;
     for (const auto& it : setLayouts)
     {
         assert(it);
         SetLayouts.emplace_back(std::static_pointer_cast<CDescriptorSetLayoutVk>(it));
         vkLayouts.emplace_back(SetLayouts.back()->GetHandle());
+        if (SetLayouts.back()->IsPushDescriptor())
+            pushDescriptorSets++;
     }
+    if (pushDescriptorSets > 1)
+        throw CRHIRuntimeError("A pipeline layout can only have one push descriptor set");
 
     VkPipelineLayoutCreateInfo info = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
     info.setLayoutCount = static_cast<uint32_t>(vkLayouts.size());
     info.pSetLayouts = vkLayouts.data();
-    info.pushConstantRangeCount = 0;
-    info.pPushConstantRanges = nullptr;
+
+    uint32_t maxSize = Parent.GetVkLimits().maxPushConstantsSize;
+    for (const auto& range : pushConstantRanges)
+    {
+        if (range.Offset + range.Size > maxSize)
+            throw CRHIRuntimeError("Push constant range exceeds maxPushConstantsSize");
+
+        VkPushConstantRange vkRange;
+        vkRange.stageFlags = VkCast(range.StageFlags);
+        vkRange.offset = range.Offset;
+        vkRange.size = range.Size;
+        PushConstantRanges.push_back(vkRange);
+    }
+    info.pushConstantRangeCount = static_cast<uint32_t>(PushConstantRanges.size());
+    info.pPushConstantRanges = PushConstantRanges.data();
     vkCreatePipelineLayout(Parent.GetVkDevice(), &info, nullptr, &Handle);
 }
 
+VkShaderStageFlags CPipelineLayoutVk::GetPushConstantStages(uint32_t offset, uint32_t size) const
+{
+    VkShaderStageFlags stages = 0;
+    for (const auto& range : PushConstantRanges)
+    {
+        if (offset < range.offset + range.size && range.offset < offset + size)
+            stages |= range.stageFlags;
+    }
+    return stages;
+}
+
 CPipelineLayoutVk::~CPipelineLayoutVk()
 {
     vkDestroyPipelineLayout(Parent.GetVkDevice(), Handle, nullptr);
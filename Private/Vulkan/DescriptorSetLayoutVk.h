@@ -4,6 +4,7 @@
 #include "VkCommon.h"
 #include "VkHelpers.h"
 
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -11,12 +12,21 @@
 namespace RHI
 {
 
+// One descriptor the way vkUpdateDescriptorSetWithTemplate reads it
+union CDescriptorSlot
+{
+    VkDescriptorImageInfo Image;
+    VkDescriptorBufferInfo Buffer;
+    VkBufferView TexelBufferView;
+};
+
 class CDescriptorSetLayoutVk : public CDescriptorSetLayout
 {
 public:
     typedef std::shared_ptr<CDescriptorSetLayoutVk> Ref;
 
-    CDescriptorSetLayoutVk(CDeviceVk& p, const std::vector<CDescriptorSetLayoutBinding>& bindings);
+    CDescriptorSetLayoutVk(CDeviceVk& p, const std::vector<CDescriptorSetLayoutBinding>& bindings,
+                           bool bPushDescriptors = false);
     ~CDescriptorSetLayoutVk() override;
 
     // Allocate and create a descriptor set from this layout
@@ -30,6 +40,28 @@ public:
     {
         return BindingToStages.at(binding);
     }
+    // Dynamic offsets are passed in binding order, this is where a binding's first element goes
+    uint32_t GetDynamicOffsetIndex(uint32_t binding) const;
+    uint32_t GetDynamicOffsetCount() const { return DynamicOffsetCount; }
+    // Has unbounded arrays, sets are written in place instead of being versioned
+    bool IsUpdateAfterBind() const { return bIsUpdateAfterBind; }
+    // Sets never get a handle, their contents are pushed into the command buffer
+    bool IsPushDescriptor() const { return bIsPushDescriptor; }
+
+    // Every descriptor of a set gets a slot in one flat array, each binding's array elements are
+    //   packed from FirstSlot on. Sorted by binding
+    struct CSlotRange
+    {
+        uint32_t Binding;
+        uint32_t FirstSlot;
+        uint32_t Count;
+    };
+    const std::vector<CSlotRange>& GetSlotRanges() const { return SlotRanges; }
+    uint32_t GetSlotCount() const { return SlotCount; }
+    // Returns nullptr if the layout doesn't have the binding
+    const CSlotRange* FindSlotRange(uint32_t binding) const;
+    // Writes every descriptor of a set from GetSlotCount() CDescriptorSlot. Null if unavailable
+    VkDescriptorUpdateTemplateKHR GetUpdateTemplate() const { return UpdateTemplate; }
 
     const std::unique_ptr<CDescriptorPoolVk>& GetDescriptorPool() const;
 
@@ -39,7 +71,18 @@ private:
     std::vector<VkDescriptorSetLayoutBinding> Bindings;
     std::map<uint32_t, VkDescriptorType> BindingToType;
     std::map<uint32_t, VkPipelineStageFlags> BindingToStages;
+    std::map<uint32_t, uint32_t> BindingToDynamicIndex;
+    uint32_t DynamicOffsetCount = 0;
+    bool bIsUpdateAfterBind = false;
+    bool bIsPushDescriptor = false;
+    static constexpr uint32_t NoSlotRange = ~0u;
+    std::vector<CSlotRange> SlotRanges;
+    // Indexed by binding number
+    std::vector<uint32_t> BindingToSlotRange;
+    uint32_t SlotCount = 0;
+    VkDescriptorUpdateTemplateKHR UpdateTemplate = VK_NULL_HANDLE;
 
+    mutable std::once_flag PoolOnce;
     mutable std::unique_ptr<CDescriptorPoolVk> Pool;
 };
 
@@ -48,16 +91,21 @@ class CPipelineLayoutVk : public CPipelineLayout
 public:
     typedef std::shared_ptr<CPipelineLayoutVk> Ref;
 
-    CPipelineLayoutVk(CDeviceVk& p, const std::vector<CDescriptorSetLayout::Ref>& setLayouts);
+    CPipelineLayoutVk(CDeviceVk& p, const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+                      const std::vector<CPushConstantRange>& pushConstantRanges);
     ~CPipelineLayoutVk() override;
 
     CDeviceVk& GetDevice() const { return Parent; }
     VkPipelineLayout GetHandle() const { return Handle; }
     const std::vector<CDescriptorSetLayoutVk::Ref>& GetSetLayouts() const { return SetLayouts; }
+    // Union of the stages of every range touching [offset, offset + size), as vkCmdPushConstants
+    //   wants them
+    VkShaderStageFlags GetPushConstantStages(uint32_t offset, uint32_t size) const;
 
 private:
     CDeviceVk& Parent;
     std::vector<CDescriptorSetLayoutVk::Ref> SetLayouts;
+    std::vector<VkPushConstantRange> PushConstantRanges;
 
     VkPipelineLayout Handle;
 };
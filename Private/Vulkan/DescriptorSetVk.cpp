@@ -8,29 +8,96 @@
 namespace RHI
 {
 
+namespace
+{
+
+// Fills slot from a bound resource and points w at it
+void PackDescriptor(VkWriteDescriptorSet& w, CDescriptorSlot& slot, const BindingInfo& bindingInfo)
+{
+    if (bindingInfo.ImageView)
+    {
+        slot.Image.sampler = VK_NULL_HANDLE;
+        slot.Image.imageView = bindingInfo.ImageView->GetVkImageView();
+        slot.Image.imageLayout = bindingInfo.ImageLayout;
+        w.pImageInfo = &slot.Image;
+    }
+    else if (bindingInfo.BufferHandle)
+    {
+        slot.Buffer.buffer = bindingInfo.BufferHandle;
+        slot.Buffer.offset = bindingInfo.Offset;
+        slot.Buffer.range = bindingInfo.Range;
+        w.pBufferInfo = &slot.Buffer;
+    }
+    else if (bindingInfo.SamplerHandle)
+    {
+        slot.Image.sampler = bindingInfo.SamplerHandle;
+        slot.Image.imageView = VK_NULL_HANDLE;
+        slot.Image.imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        w.pImageInfo = &slot.Image;
+    }
+}
+
+}
+
 RHI::CDescriptorSetVk::CDescriptorSetVk(CDescriptorSetLayoutVk::Ref layout)
     : Layout(layout)
+    , ResourceBindings(*Layout)
 {
+    DynamicOffsets.resize(Layout->GetDynamicOffsetCount(), 0);
+
+    // Bindless sets live forever and are written in place as things get bound
+    if (Layout->IsUpdateAfterBind())
+    {
+        Handle = Layout->GetDescriptorPool()->AllocateDescriptorSet();
+        if (!Handle)
+            throw CRHIRuntimeError("Descriptor set allocation failed");
+        bIsHandlePersistent = true;
+    }
+    else
+        Slots.resize(Layout->GetSlotCount());
 }
 
-RHI::CDescriptorSetVk::~CDescriptorSetVk() {}
+RHI::CDescriptorSetVk::~CDescriptorSetVk() { ReleaseHandle(); }
 
 void RHI::CDescriptorSetVk::BindBuffer(CBuffer::Ref buffer, size_t offset, size_t range,
                                        uint32_t binding, uint32_t index)
 {
-    auto handle = std::static_pointer_cast<CBufferVk>(buffer)->GetHandle();
-    ResourceBindings.BindBuffer(handle, offset, range, 0, binding, index);
+    auto impl = std::static_pointer_cast<CBufferVk>(buffer);
+    // Would reach into the neighbours of a buffer that shares its VkBuffer
+    if (range == VK_WHOLE_SIZE)
+        range = impl->GetSize() - offset;
+    auto lk = LockIfPersistent();
+    ResourceBindings.BindBuffer(impl.get(), offset, range, binding, index);
+    if (bIsHandlePersistent)
+        WriteInPlace(binding, index);
 }
 
 void CDescriptorSetVk::BindConstants(const void* data, size_t size, uint32_t binding,
                                      uint32_t index)
 {
     auto* bufferImpl = Layout->GetDevice().GetHugeConstantBuffer();
+    VkBuffer buffer;
     size_t offset;
     size_t minAlignment = Layout->GetDevice().GetVkLimits().minUniformBufferOffsetAlignment;
-    void* bufferData = bufferImpl->Allocate(size, minAlignment, offset);
+    void* bufferData = bufferImpl->Allocate(size, minAlignment, buffer, offset);
+    if (!bufferData)
+        throw CRHIRuntimeError("Out of memory for constants");
     memcpy(bufferData, data, size);
-    ResourceBindings.BindBuffer(bufferImpl->GetHandle(), offset, size, 0, binding, index);
+
+    auto lk = LockIfPersistent();
+    if (Layout->GetDescriptorType(binding) == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+    {
+        // The descriptor always points at the start of a ring page, only the dynamic offset
+        //   moves. So as long as the page and the size stay the same the set isn't rewritten
+        const auto* info = ResourceBindings.GetBinding(binding, index);
+        if (!info || info->BufferHandle != buffer || info->Offset != 0 || info->Range != size)
+            ResourceBindings.BindBuffer(buffer, 0, size, binding, index, true);
+        SetDynamicOffset(offset, binding, index);
+    }
+    else
+        ResourceBindings.BindBuffer(buffer, offset, size, binding, index, true);
+    if (bIsHandlePersistent)
+        WriteInPlace(binding, index);
 }
 
 void RHI::CDescriptorSetVk::BindImageView(CImageView::Ref imageView, uint32_t binding,
@@ -40,7 +107,9 @@ void RHI::CDescriptorSetVk::BindImageView(CImageView::Ref imageView, uint32_t bi
 
     VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     VkAccessFlags access = VK_ACCESS_SHADER_READ_BIT;
-    if (Any(impl->GetImage()->GetUsageFlags(), EImageUsageFlags::Storage))
+    // Internal passes bind storage views of images that weren't created with Storage
+    if (Any(impl->GetImage()->GetUsageFlags(), EImageUsageFlags::Storage)
+        || Layout->GetDescriptorType(binding) == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
     {
         layout = VK_IMAGE_LAYOUT_GENERAL;
         access |= VK_ACCESS_SHADER_WRITE_BIT;
@@ -49,13 +118,32 @@ void RHI::CDescriptorSetVk::BindImageView(CImageView::Ref imageView, uint32_t bi
         layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
     VkPipelineStageFlags stages = Layout->GetPipelineStages(binding);
 
-    ResourceBindings.BindImageView(impl.get(), access, stages, layout, 0, binding, index);
+    auto lk = LockIfPersistent();
+    ResourceBindings.BindImageView(impl.get(), access, stages, layout, binding, index);
+    if (bIsHandlePersistent)
+    {
+        WriteInPlace(binding, index);
+        PendingImages.emplace_back(binding, index);
+        bHasPendingImages = true;
+    }
 }
 
 void RHI::CDescriptorSetVk::BindSampler(CSampler::Ref sampler, uint32_t binding, uint32_t index)
 {
     auto impl = std::static_pointer_cast<CSamplerVk>(sampler);
-    ResourceBindings.BindSampler(impl->Sampler, 0, binding, index);
+    auto lk = LockIfPersistent();
+    ResourceBindings.BindSampler(impl->Sampler, binding, index);
+    if (bIsHandlePersistent)
+        WriteInPlace(binding, index);
+}
+
+void CDescriptorSetVk::Unbind(uint32_t binding, uint32_t index)
+{
+    // Partially bound, so the stale descriptor is fine as long as no shader reads it
+    auto lk = LockIfPersistent();
+    ResourceBindings.Unbind(binding, index);
+    if (bIsHandlePersistent)
+        ResourceBindings.ClearDirtyBits();
 }
 
 void RHI::CDescriptorSetVk::BindBufferView(CBufferView::Ref bufferView, uint32_t binding,
@@ -66,128 +154,291 @@ void RHI::CDescriptorSetVk::BindBufferView(CBufferView::Ref bufferView, uint32_t
 
 void CDescriptorSetVk::SetDynamicOffset(size_t offset, uint32_t binding, uint32_t index)
 {
-    throw "unimplemented";
+    uint32_t i = Layout->GetDynamicOffsetIndex(binding) + index;
+    if (i >= DynamicOffsets.size())
+        throw CRHIRuntimeError("Dynamic offset array index out of range");
+    if (DynamicOffsets[i] != offset)
+    {
+        DynamicOffsets[i] = static_cast<uint32_t>(offset);
+        bDynamicOffsetsDirty = true;
+    }
 }
 
 VkDescriptorSet RHI::CDescriptorSetVk::GetHandle() { return Handle; }
 
 void CDescriptorSetVk::DiscardAndRecreate()
 {
-    // Discard the old handle
-    if (Handle)
-    {
-        auto l = Layout;
-        auto h = Handle;
-        Layout->GetDevice().AddPostFrameCleanup(
-            [l, h](CDeviceVk& p) { l->GetDescriptorPool()->FreeDescriptorSet(h); });
-    }
+    ReleaseHandle();
 
-    const auto& poolPtr = Layout->GetDescriptorPool();
-    Handle = poolPtr->AllocateDescriptorSet();
+    auto* transientPool = Layout->GetDevice().GetTransientDescriptorPool();
+    Handle = transientPool->Allocate(*Layout);
+    HandleFrame = transientPool->GetCurrentFrame();
 }
 
-void CDescriptorSetVk::WriteUpdates(CAccessTracker& tracker, VkCommandBuffer cmdBuffer)
+bool CDescriptorSetVk::IsHandleExpired() const
 {
-    if (!ResourceBindings.IsDirty())
-    {
-        // Update access tracker only
-        auto& setBindings = ResourceBindings.GetSetBindings().begin()->second;
-        for (const auto& bindingIter : setBindings.Bindings)
-        {
-            for (const auto& arrayIter : bindingIter.second)
-            {
-                if (arrayIter.second.ImageView)
-                {
-                    tracker.TransitionImage(cmdBuffer, arrayIter.second.ImageView->GetImage().get(),
-                                            arrayIter.second.ImageView->GetResourceRange(),
-                                            arrayIter.second.ImageAccess,
-                                            arrayIter.second.ImageStages,
-                                            arrayIter.second.ImageLayout);
-                }
-            }
-        }
+    return Handle && !bIsHandleCached && !bIsHandlePersistent
+        && HandleFrame != Layout->GetDevice().GetTransientDescriptorPool()->GetCurrentFrame();
+}
+
+bool CDescriptorSetVk::HasMovedResources() const
+{
+    auto* defragmenter = Layout->GetDevice().GetDefragmenter();
+    return defragmenter && defragmenter->GetGeneration() != ResourceGeneration;
+}
+
+void CDescriptorSetVk::RefreshMovedResources()
+{
+    if (!HasMovedResources())
+        return;
+    auto* defragmenter = Layout->GetDevice().GetDefragmenter();
+    ResourceGeneration = defragmenter->GetGeneration();
+    if (!ResourceBindings.RefreshMoved(*defragmenter) || !bIsHandlePersistent)
         return;
-    }
 
-    ResourceBindings.ClearDirtyBit();
+    std::vector<std::pair<uint32_t, uint32_t>> moved;
+    ResourceBindings.ForEachDirty([&](uint32_t binding, uint32_t index, uint32_t,
+                                      const BindingInfo&) { moved.emplace_back(binding, index); });
+    for (const auto& pair : moved)
+        WriteInPlace(pair.first, pair.second);
+}
 
-    if (bIsUsed || !Handle)
+void CDescriptorSetVk::WriteUpdates(CAccessTracker& tracker, VkCommandBuffer cmdBuffer)
+{
+    auto lk = LockIfPersistent();
+    RefreshMovedResources();
+    TransitionImages(tracker, cmdBuffer);
+    if (bIsHandlePersistent || Layout->IsPushDescriptor())
+        return;
+    bool bIsExpired = IsHandleExpired();
+    if (!ResourceBindings.IsDirty() && !bIsExpired)
+        return;
+
+    // Look for a set with the same contents before writing a new one
+    if (MakeCacheKey(CacheKey))
+    {
+        auto* cache = Layout->GetDevice().GetDescriptorSetCache();
+        VkDescriptorSet handle =
+            cache->Acquire(Layout, CacheKey, [this](VkDescriptorSet h) { WriteDescriptors(h); });
+        ReleaseHandle();
+        Handle = handle;
+        bIsHandleCached = true;
+    }
+    else if (bIsUsed || !Handle || bIsHandleCached || bIsExpired)
     {
         DiscardAndRecreate();
         bIsUsed = false;
+        WriteDescriptors(Handle);
     }
+    else
+    {
+        // Nothing has recorded the handle yet, so it only needs what changed since
+        WriteDescriptors(Handle, true);
+    }
+    ResourceBindings.ClearDirtyBits();
+}
+
+VkDescriptorSet CDescriptorSetVk::AcquireForBundle(CAccessTracker& tracker)
+{
+    auto lk = LockIfPersistent();
+    RefreshMovedResources();
+    ResourceBindings.ForEachBound(
+        [](uint32_t, uint32_t, uint32_t, const BindingInfo& bindingInfo) {
+            if (bindingInfo.bIsTransient)
+                throw CRHIRuntimeError("Render bundles can't use BindConstants, the constant "
+                                       "memory is recycled with the frame");
+            if (bindingInfo.ImageView && bindingInfo.ImageView->bIsSwapChainProxy)
+                throw CRHIRuntimeError("Render bundles can't use swapchain images");
+        });
+    TransitionImages(tracker, VK_NULL_HANDLE);
+    if (bIsHandlePersistent)
+        return Handle;
+    if (Layout->IsPushDescriptor())
+        return VK_NULL_HANDLE;
+
+    MakeCacheKey(CacheKey);
+    return Layout->GetDevice().GetDescriptorSetCache()->Acquire(
+        Layout, CacheKey, [this](VkDescriptorSet h) { WriteDescriptors(h); });
+}
+
+bool CDescriptorSetVk::MakeCacheKey(CDescriptorSetKey& key)
+{
+    bool bCacheable = true;
+    key.Layout = Layout.get();
+    key.Elements.clear();
+    ResourceBindings.ForEachBound([&](uint32_t binding, uint32_t index, uint32_t,
+                                      const BindingInfo& bindingInfo) {
+        CDescriptorSetKey::CElement e {};
+        e.Binding = binding;
+        e.ArrayElement = index;
+        if (bindingInfo.ImageView)
+        {
+            // The view behind a swapchain proxy changes every frame
+            if (bindingInfo.ImageView->bIsSwapChainProxy)
+                bCacheable = false;
+            e.Handle = GetHandleKey(bindingInfo.ImageView->GetVkImageView());
+            e.ImageLayout = bindingInfo.ImageLayout;
+        }
+        else if (bindingInfo.BufferHandle)
+        {
+            // Constants at a fixed ring offset are overwritten a few frames later
+            if (bindingInfo.bIsTransient
+                && Layout->GetDescriptorType(binding) != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+                bCacheable = false;
+            e.Handle = GetHandleKey(bindingInfo.BufferHandle);
+            e.Offset = bindingInfo.Offset;
+            e.Range = bindingInfo.Range;
+        }
+        else if (bindingInfo.SamplerHandle)
+            e.Handle = GetHandleKey(bindingInfo.SamplerHandle);
+        key.Elements.push_back(e);
+    });
+    if (!bCacheable)
+        return false;
+    key.Finalize();
+    return true;
+}
 
-    // Since we only have one descriptor set, the first SetBindings is it
-    auto& setBindings = ResourceBindings.GetSetBindings().begin()->second;
-    setBindings.bDirty = false;
+void CDescriptorSetVk::TransitionImages(CAccessTracker& tracker, VkCommandBuffer cmdBuffer)
+{
+    auto transition = [&](const BindingInfo& bindingInfo) {
+        tracker.TransitionImage(cmdBuffer, bindingInfo.ImageView->GetImage().get(),
+                                bindingInfo.ImageView->GetResourceRange(), bindingInfo.ImageAccess,
+                                bindingInfo.ImageStages, bindingInfo.ImageLayout);
+    };
 
-    std::vector<VkWriteDescriptorSet> writes;
-    std::vector<VkDescriptorImageInfo> imageInfos;
-    std::vector<VkDescriptorBufferInfo> bufferInfos;
-    std::vector<VkBufferView> bufferViews;
-    for (const auto& bindingIter : setBindings.Bindings)
+    // Persistent sets keep their images in place, each only needs to be transitioned once by
+    //   the first list that uses it
+    if (bIsHandlePersistent)
     {
-        uint32_t binding = bindingIter.first;
-        for (const auto& arrayIter : bindingIter.second)
+        for (const auto& pair : PendingImages)
         {
-            uint32_t index = arrayIter.first;
-            const auto& bindingInfo = arrayIter.second;
+            const auto* bindingInfo = ResourceBindings.GetBinding(pair.first, pair.second);
+            if (bindingInfo && bindingInfo->ImageView)
+                transition(*bindingInfo);
+        }
+        PendingImages.clear();
+        bHasPendingImages = false;
+        return;
+    }
+
+    ResourceBindings.ForEachBound(
+        [&](uint32_t, uint32_t, uint32_t, const BindingInfo& bindingInfo) {
+            if (bindingInfo.ImageView)
+                transition(bindingInfo);
+        });
+}
+
+void CDescriptorSetVk::WriteDescriptors(VkDescriptorSet dst, bool bOnlyDirty)
+{
+    if (!bOnlyDirty && WriteWithTemplate(dst))
+        return;
+
+    Writes.clear();
+    auto addWrite = [&](uint32_t binding, uint32_t index, uint32_t slot,
+                        const BindingInfo& bindingInfo) {
+        Writes.push_back({ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET });
+        auto& w = Writes.back();
+        w.dstSet = dst;
+        w.dstBinding = binding;
+        w.dstArrayElement = index;
+        w.descriptorCount = 1;
+        w.descriptorType = Layout->GetDescriptorType(binding);
+        PackDescriptor(w, Slots[slot], bindingInfo);
+    };
+    if (bOnlyDirty)
+        ResourceBindings.ForEachDirty(addWrite);
+    else
+        ResourceBindings.ForEachBound(addWrite);
+
+    if (!Writes.empty())
+        vkUpdateDescriptorSets(Layout->GetDevice().GetVkDevice(),
+                               static_cast<uint32_t>(Writes.size()), Writes.data(), 0, nullptr);
+}
 
-            writes.push_back({ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET });
-            auto& w = writes.back();
-            w.dstSet = Handle;
+uint32_t CDescriptorSetVk::Push(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint,
+                                VkPipelineLayout pipelineLayout, uint32_t set)
+{
+    RefreshMovedResources();
+    Writes.clear();
+    ResourceBindings.ForEachBound(
+        [&](uint32_t binding, uint32_t index, uint32_t slot, const BindingInfo& bindingInfo) {
+            Writes.push_back({ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET });
+            auto& w = Writes.back();
             w.dstBinding = binding;
             w.dstArrayElement = index;
             w.descriptorCount = 1;
             w.descriptorType = Layout->GetDescriptorType(binding);
+            PackDescriptor(w, Slots[slot], bindingInfo);
+        });
+    ResourceBindings.ClearDirtyBits();
 
-            if (bindingInfo.ImageView)
-            {
-                VkDescriptorImageInfo info {};
-                info.imageView = bindingInfo.ImageView->GetVkImageView();
-                info.imageLayout = bindingInfo.ImageLayout;
-
-                tracker.TransitionImage(cmdBuffer, bindingInfo.ImageView->GetImage().get(),
-                                        bindingInfo.ImageView->GetResourceRange(),
-                                        bindingInfo.ImageAccess, bindingInfo.ImageStages,
-                                        bindingInfo.ImageLayout);
-
-                imageInfos.push_back(info);
-                w.pImageInfo = reinterpret_cast<const VkDescriptorImageInfo*>(imageInfos.size());
-            }
-            else if (bindingInfo.BufferHandle)
-            {
-                VkDescriptorBufferInfo info {};
-                info.buffer = bindingInfo.BufferHandle;
-                info.offset = bindingInfo.Offset;
-                info.range = bindingInfo.Range;
-
-                bufferInfos.push_back(info);
-                w.pBufferInfo = reinterpret_cast<const VkDescriptorBufferInfo*>(bufferInfos.size());
-            }
-            else if (bindingInfo.SamplerHandle)
-            {
-                VkDescriptorImageInfo info {};
-                info.sampler = bindingInfo.SamplerHandle;
-
-                imageInfos.push_back(info);
-                w.pImageInfo = reinterpret_cast<const VkDescriptorImageInfo*>(imageInfos.size());
-            }
-        }
-    }
+    auto count = static_cast<uint32_t>(Writes.size());
+    if (count > 0)
+        Layout->GetDevice().CmdPushDescriptorSet(cmdBuffer, bindPoint, pipelineLayout, set, count,
+                                                 Writes.data());
+    return count;
+}
+
+bool CDescriptorSetVk::WriteWithTemplate(VkDescriptorSet dst)
+{
+    VkDescriptorUpdateTemplateKHR updateTemplate = Layout->GetUpdateTemplate();
+    if (!updateTemplate || !ResourceBindings.IsFullyBound())
+        return false;
+
+    VkWriteDescriptorSet unused;
+    ResourceBindings.ForEachBound(
+        [&](uint32_t, uint32_t, uint32_t slot, const BindingInfo& bindingInfo) {
+            PackDescriptor(unused, Slots[slot], bindingInfo);
+        });
+    Layout->GetDevice().UpdateDescriptorSetWithTemplate(dst, updateTemplate, Slots.data());
+    return true;
+}
+
+void CDescriptorSetVk::ReleaseHandle()
+{
+    if (!Handle)
+        return;
 
-    for (auto& w : writes)
+    // Transient handles are simply dropped, their pool is reset when the frame retires
+    if (bIsHandlePersistent)
     {
-        if (w.pImageInfo)
-            w.pImageInfo = &imageInfos[reinterpret_cast<size_t>(w.pImageInfo) - 1];
-        if (w.pBufferInfo)
-            w.pBufferInfo = &bufferInfos[reinterpret_cast<size_t>(w.pBufferInfo) - 1];
-        if (w.pTexelBufferView)
-            w.pTexelBufferView = &bufferViews[reinterpret_cast<size_t>(w.pTexelBufferView) - 1];
+        auto l = Layout;
+        auto h = Handle;
+        Layout->GetDevice().AddPostFrameCleanup(
+            [l, h](CDeviceVk& p) { l->GetDescriptorPool()->FreeDescriptorSet(h); });
     }
+    else if (bIsHandleCached)
+        Layout->GetDevice().GetDescriptorSetCache()->Release(Handle);
+    Handle = VK_NULL_HANDLE;
+    bIsHandleCached = false;
+}
+
+std::unique_lock<std::mutex> CDescriptorSetVk::LockIfPersistent()
+{
+    if (bIsHandlePersistent)
+        return std::unique_lock<std::mutex>(PersistentMutex);
+    return std::unique_lock<std::mutex>();
+}
+
+void CDescriptorSetVk::WriteInPlace(uint32_t binding, uint32_t index)
+{
+    ResourceBindings.ClearDirtyBits();
+    const auto* bindingInfo = ResourceBindings.GetBinding(binding, index);
+    if (!bindingInfo)
+        return;
+
+    VkWriteDescriptorSet w = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+    w.dstSet = Handle;
+    w.dstBinding = binding;
+    w.dstArrayElement = index;
+    w.descriptorCount = 1;
+    w.descriptorType = Layout->GetDescriptorType(binding);
+
+    CDescriptorSlot slot;
+    PackDescriptor(w, slot, *bindingInfo);
 
-    vkUpdateDescriptorSets(Layout->GetDevice().GetVkDevice(), static_cast<uint32_t>(writes.size()),
-                           writes.data(), 0, nullptr);
+    vkUpdateDescriptorSets(Layout->GetDevice().GetVkDevice(), 1, &w, 0, nullptr);
 }
 
 }
@@ -1,7 +1,10 @@
 #pragma once
 #include "AccessTracker.h"
+#include "DescriptorSetCacheVk.h"
 #include "DescriptorSetLayoutVk.h"
 #include "ResourceBindingsVk.h"
+#include <atomic>
+#include <mutex>
 
 namespace RHI
 {
@@ -24,18 +27,85 @@ public:
 
     // Internal API
     VkDescriptorSet GetHandle();
-    bool IsContentDirty() const { return ResourceBindings.IsDirty(); }
-    void DiscardAndRecreate(); // Similar to the DX11 MapDiscard semantics
+    bool IsContentDirty() const
+    {
+        // Persistent handles are written as things get bound, only new images need a look
+        if (bIsHandlePersistent)
+            return bHasPendingImages.load() || HasMovedResources();
+        return ResourceBindings.IsDirty() || IsHandleExpired() || HasMovedResources();
+    }
+    // Changing dynamic offsets only needs a rebind, not a new descriptor set
+    bool AreDynamicOffsetsDirty() const { return bDynamicOffsetsDirty; }
+    const std::vector<uint32_t>& GetDynamicOffsets() const { return DynamicOffsets; }
+    void ClearDynamicOffsetsDirty() { bDynamicOffsetsDirty = false; }
+    // Similar to the DX11 MapDiscard semantics, the new handle comes from the transient pool
+    void DiscardAndRecreate();
     void WriteUpdates(CAccessTracker& tracker, VkCommandBuffer cmdBuffer);
-    void SetUsed() { bIsUsed = true; }
+    bool IsPushDescriptor() const { return Layout->IsPushDescriptor(); }
+    // Records the whole set into the command buffer, returns how many descriptors that took
+    uint32_t Push(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint,
+                  VkPipelineLayout pipelineLayout, uint32_t set);
+    void SetUsed()
+    {
+        // Shared between threads, and never rewritten anyway
+        if (!bIsHandlePersistent)
+            bIsUsed = true;
+    }
+    void Unbind(uint32_t binding, uint32_t index);
+    bool IsPersistent() const { return bIsHandlePersistent; }
+    // Render bundles are replayed in later frames, so they get a cached handle the caller has to
+    //   release, the persistent handle, or null for push sets. Throws if something bound only
+    //   lives for the frame
+    VkDescriptorSet AcquireForBundle(CAccessTracker& tracker);
 
 private:
+    // Transient handles are reset along with their frame
+    bool IsHandleExpired() const;
+    // Something was defragmented since the bindings were last checked
+    bool HasMovedResources() const;
+    void RefreshMovedResources();
+    // Returns false if the contents are only valid for this frame and shouldn't be shared
+    bool MakeCacheKey(CDescriptorSetKey& key);
+    void TransitionImages(CAccessTracker& tracker, VkCommandBuffer cmdBuffer);
+    // Only dirty descriptors is for a handle that already holds the previous contents
+    void WriteDescriptors(VkDescriptorSet dst, bool bOnlyDirty = false);
+    // Returns false if some descriptor is unbound, a template always writes all of them
+    bool WriteWithTemplate(VkDescriptorSet dst);
+    // Gives the current handle back to the cache or the pool
+    void ReleaseHandle();
+    // Update after bind sets skip the versioning and write the one descriptor right away
+    void WriteInPlace(uint32_t binding, uint32_t index);
+    // Update after bind sets are bound and recorded from several threads at once
+    std::unique_lock<std::mutex> LockIfPersistent();
+
     // Holds the layout alive
     CDescriptorSetLayoutVk::Ref Layout;
 
     // NOTE: lazy create and update
     CResourceBindings ResourceBindings;
+    // Scratch for descriptor writes, kept around so updates don't allocate
+    std::vector<CDescriptorSlot> Slots;
+    std::vector<VkWriteDescriptorSet> Writes;
+    CDescriptorSetKey CacheKey;
     VkDescriptorSet Handle = VK_NULL_HANDLE;
+    // Cached handles are shared and must never be written to
+    bool bIsHandleCached = false;
+    // Allocated once for update after bind layouts
+    bool bIsHandlePersistent = false;
+    // Guards ResourceBindings of persistent sets
+    std::mutex PersistentMutex;
+    // Images bound to a persistent set that no command list has transitioned yet, so binding
+    //   a bindless heap doesn't walk every image ever registered
+    std::vector<std::pair<uint32_t, uint32_t>> PendingImages;
+    std::atomic<bool> bHasPendingImages { false };
+    // Otherwise the handle came from the transient pool in this frame
+    uint64_t HandleFrame = 0;
+    // Defragmenter generation the bindings were last checked against
+    std::atomic<uint64_t> ResourceGeneration { 0 };
+
+    // One per dynamic descriptor, in the order vkCmdBindDescriptorSets wants
+    std::vector<uint32_t> DynamicOffsets;
+    bool bDynamicOffsetsDirty = false;
 
     // If used, we can't freely update this anymore
     bool bIsUsed = false;
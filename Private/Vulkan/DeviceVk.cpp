@@ -8,10 +8,13 @@
 #include "SamplerVk.h"
 #include "ShaderModuleVk.h"
 #include "SwapChainVk.h"
+#include "TextureFile.h"
 #include "VkHelpers.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <numeric>
 #include <vector>
 
 #if TC_OS == TC_OS_LINUX
@@ -51,6 +54,8 @@ static void initDebugCallback(VkInstance instance, VkDebugReportCallbackEXT* pCa
 
 static VkInstance Instance;
 static VkDebugReportCallbackEXT DebugRptCallback;
+// Needed to query descriptor indexing support on a 1.0 instance
+static bool bHasPhysicalDeviceProperties2 = false;
 
 void InitRHIInstance()
 {
@@ -89,6 +94,15 @@ void InitRHIInstance()
                                                     "VK_MVK_macos_surface"
 #endif
     };
+    for (const auto& extProp : extensionProps)
+    {
+        if (strcmp(extProp.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
+            == 0)
+        {
+            requiredExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            bHasPhysicalDeviceProperties2 = true;
+        }
+    }
 
     const std::vector<const char*> validationLayers = { "VK_LAYER_LUNARG_standard_validation" };
 
@@ -176,7 +190,7 @@ static VkPhysicalDevice selectPhysicalDevice(const std::vector<VkPhysicalDevice>
     return bestDevice;
 }
 
-CDeviceVk::CDeviceVk(EDeviceCreateHints hints)
+CDeviceVk::CDeviceVk(EDeviceCreateHints hints, const CDeviceCreateOptions& options)
     : QueueFamilies { (uint32_t)-1, (uint32_t)-1, (uint32_t)-1 }
 {
     uint32_t physDeviceCount;
@@ -195,78 +209,155 @@ CDeviceVk::CDeviceVk(EDeviceCreateHints hints)
     vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &queueFamilyCount,
                                              queueFamilyProperites.data());
 
+    // Prefer dedicated families for compute and copy so they can overlap with rendering
+    const uint32_t invalidFamily = static_cast<uint32_t>(-1);
     for (uint32_t i = 0; i < queueFamilyCount; i++)
     {
         VkQueueFlags flags = queueFamilyProperites[i].queueFlags;
-        if ((flags & VK_QUEUE_GRAPHICS_BIT) != 0)
-        {
+        bool graphics = (flags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        bool compute = (flags & VK_QUEUE_COMPUTE_BIT) != 0;
+        bool transfer = (flags & VK_QUEUE_TRANSFER_BIT) != 0;
+        if (graphics && QueueFamilies[static_cast<int>(EQueueType::Render)] == invalidFamily)
             QueueFamilies[static_cast<int>(EQueueType::Render)] = i;
+        if (compute && !graphics
+            && QueueFamilies[static_cast<int>(EQueueType::Compute)] == invalidFamily)
             QueueFamilies[static_cast<int>(EQueueType::Compute)] = i;
+        if (transfer && !graphics && !compute
+            && QueueFamilies[static_cast<int>(EQueueType::Copy)] == invalidFamily)
             QueueFamilies[static_cast<int>(EQueueType::Copy)] = i;
-            break;
-        }
-        if ((flags & VK_QUEUE_COMPUTE_BIT) != 0 && (flags & VK_QUEUE_GRAPHICS_BIT) == 0)
-            QueueFamilies[static_cast<int>(EQueueType::Compute)] = i;
-        if ((flags & VK_QUEUE_TRANSFER_BIT) != 0 && (flags & VK_QUEUE_GRAPHICS_BIT) == 0)
-            QueueFamilies[static_cast<int>(EQueueType::Copy)] = i;
     }
+    if (QueueFamilies[static_cast<int>(EQueueType::Render)] == invalidFamily)
+        throw CRHIRuntimeError("Device has no graphics queue family");
+    if (QueueFamilies[static_cast<int>(EQueueType::Compute)] == invalidFamily)
+        QueueFamilies[static_cast<int>(EQueueType::Compute)] =
+            QueueFamilies[static_cast<int>(EQueueType::Render)];
+    // Compute families always support transfer
+    if (QueueFamilies[static_cast<int>(EQueueType::Copy)] == invalidFamily)
+        QueueFamilies[static_cast<int>(EQueueType::Copy)] =
+            QueueFamilies[static_cast<int>(EQueueType::Compute)];
+
+    // Render comes first so it's always UniqueQueueFamilies[0]
+    for (EQueueType t : { EQueueType::Render, EQueueType::Compute, EQueueType::Copy })
+    {
+        uint32_t family = QueueFamilies[static_cast<int>(t)];
+        if (std::find(UniqueQueueFamilies.begin(), UniqueQueueFamilies.end(), family)
+            == UniqueQueueFamilies.end())
+            UniqueQueueFamilies.push_back(family);
+    }
+    QueueFamilyProperties = queueFamilyProperites;
 
     // Enable all features
     VkPhysicalDeviceFeatures requiredFeatures;
     vkGetPhysicalDeviceFeatures(PhysicalDevice, &requiredFeatures);
 
+    // Grab every queue of each family, CreateCommandQueue rotates through them
     std::vector<VkDeviceQueueCreateInfo> queueInfos;
     std::vector<float> queuePriorities;
     queuePriorities.reserve(1024);
-
+    for (uint32_t family : UniqueQueueFamilies)
     {
         VkDeviceQueueCreateInfo info = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
-        queueFamilyProperites.at(QueueFamilies[static_cast<int>(EQueueType::Render)]).queueCount =
-            1;
-        info.queueCount =
-            queueFamilyProperites.at(QueueFamilies[static_cast<int>(EQueueType::Render)])
-                .queueCount;
-        info.queueFamilyIndex = QueueFamilies[static_cast<int>(EQueueType::Render)];
+        info.queueCount = queueFamilyProperites.at(family).queueCount;
+        info.queueFamilyIndex = family;
         for (uint32_t unused = 0; unused < info.queueCount; unused++)
             queuePriorities.push_back(1.0f);
         info.pQueuePriorities = &queuePriorities.back() - info.queueCount + 1;
         queueInfos.push_back(info);
     }
-    if (QueueFamilies[static_cast<int>(EQueueType::Compute)]
-        != QueueFamilies[static_cast<int>(EQueueType::Render)])
+
+    std::vector<const char*> extensionNames = { "VK_KHR_swapchain" };
+
+    // Descriptor indexing for the bindless heap, also enable everything it supports
+    uint32_t deviceExtCount = 0;
+    vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &deviceExtCount, nullptr);
+    std::vector<VkExtensionProperties> deviceExtProps(deviceExtCount);
+    vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &deviceExtCount,
+                                         deviceExtProps.data());
+    auto hasDeviceExtension = [&](const char* name) {
+        return std::any_of(deviceExtProps.begin(), deviceExtProps.end(),
+                           [=](const VkExtensionProperties& p) {
+                               return strcmp(p.extensionName, name) == 0;
+                           });
+    };
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT
+    };
+    DescriptorIndexingProperties = {
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT
+    };
+    if (bHasPhysicalDeviceProperties2
+        && hasDeviceExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)
+        && hasDeviceExtension(VK_KHR_MAINTENANCE3_EXTENSION_NAME))
     {
-        VkDeviceQueueCreateInfo info = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
-        queueFamilyProperites.at(QueueFamilies[static_cast<int>(EQueueType::Compute)]).queueCount =
-            1;
-        info.queueCount =
-            queueFamilyProperites.at(QueueFamilies[static_cast<int>(EQueueType::Compute)])
-                .queueCount;
-        info.queueFamilyIndex = QueueFamilies[static_cast<int>(EQueueType::Compute)];
-        for (uint32_t unused = 0; unused < info.queueCount; unused++)
-            queuePriorities.push_back(1.0f);
-        info.pQueuePriorities = &queuePriorities.back() - info.queueCount + 1;
-        queueInfos.push_back(info);
+        auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(
+            Instance, "vkGetPhysicalDeviceFeatures2KHR");
+        auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(
+            Instance, "vkGetPhysicalDeviceProperties2KHR");
+
+        VkPhysicalDeviceFeatures2KHR features2 = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR
+        };
+        features2.pNext = &indexingFeatures;
+        getFeatures2(PhysicalDevice, &features2);
+        VkPhysicalDeviceProperties2KHR properties2 = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR
+        };
+        properties2.pNext = &DescriptorIndexingProperties;
+        getProperties2(PhysicalDevice, &properties2);
+        indexingFeatures.pNext = nullptr;
+
+        bSupportsDescriptorIndexing = indexingFeatures.runtimeDescriptorArray
+            && indexingFeatures.descriptorBindingPartiallyBound
+            && indexingFeatures.descriptorBindingUpdateUnusedWhilePending
+            && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+            && indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind;
+        if (bSupportsDescriptorIndexing)
+        {
+            extensionNames.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+            extensionNames.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        }
     }
-    if (QueueFamilies[static_cast<int>(EQueueType::Copy)]
-            != QueueFamilies[static_cast<int>(EQueueType::Compute)]
-        && QueueFamilies[static_cast<int>(EQueueType::Copy)]
-            != QueueFamilies[static_cast<int>(EQueueType::Render)])
+
+    // Lets descriptor sets be written from one packed array
+    bool bSupportsUpdateTemplates =
+        hasDeviceExtension(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    if (bSupportsUpdateTemplates)
+        extensionNames.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+
+    // Small per draw sets skip descriptor pools entirely
+    bool bSupportsPushDescriptors = bHasPhysicalDeviceProperties2
+        && hasDeviceExtension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    if (bSupportsPushDescriptors)
     {
-        VkDeviceQueueCreateInfo info = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
-        queueFamilyProperites.at(QueueFamilies[static_cast<int>(EQueueType::Copy)]).queueCount = 1;
-        info.queueCount =
-            queueFamilyProperites.at(QueueFamilies[static_cast<int>(EQueueType::Copy)]).queueCount;
-        info.queueFamilyIndex = QueueFamilies[static_cast<int>(EQueueType::Copy)];
-        for (uint32_t unused = 0; unused < info.queueCount; unused++)
-            queuePriorities.push_back(1.0f);
-        info.pQueuePriorities = &queuePriorities.back() - info.queueCount + 1;
-        queueInfos.push_back(info);
+        auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(
+            Instance, "vkGetPhysicalDeviceProperties2KHR");
+        VkPhysicalDevicePushDescriptorPropertiesKHR pushProperties = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR
+        };
+        VkPhysicalDeviceProperties2KHR properties2 = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR
+        };
+        properties2.pNext = &pushProperties;
+        getProperties2(PhysicalDevice, &properties2);
+        MaxPushDescriptors = pushProperties.maxPushDescriptors;
+        extensionNames.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
     }
 
-    std::vector<const char*> extensionNames = { "VK_KHR_swapchain" };
+    // Per heap budgets for GetMemoryStats
+    bool bSupportsMemoryBudget =
+        bHasPhysicalDeviceProperties2 && hasDeviceExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (bSupportsMemoryBudget)
+    {
+        GetMemoryProperties2Fn = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(
+            Instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+        extensionNames.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
 
     // Logical Device
     VkDeviceCreateInfo deviceInfo = {};
+    if (bSupportsDescriptorIndexing)
+        deviceInfo.pNext = &indexingFeatures;
     deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceInfo.queueCreateInfoCount = (uint32_t)queueInfos.size();
     deviceInfo.pQueueCreateInfos = queueInfos.data();
@@ -276,6 +367,22 @@ CDeviceVk::CDeviceVk(EDeviceCreateHints hints)
 
     vkCreateDevice(PhysicalDevice, &deviceInfo, nullptr, &Device);
 
+    if (bSupportsPushDescriptors)
+        CmdPushDescriptorSetFn = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(
+            Device, "vkCmdPushDescriptorSetKHR");
+    if (!CmdPushDescriptorSetFn)
+        MaxPushDescriptors = 0;
+
+    if (bSupportsUpdateTemplates)
+    {
+        CreateDescriptorUpdateTemplateFn = (PFN_vkCreateDescriptorUpdateTemplateKHR)
+            vkGetDeviceProcAddr(Device, "vkCreateDescriptorUpdateTemplateKHR");
+        DestroyDescriptorUpdateTemplateFn = (PFN_vkDestroyDescriptorUpdateTemplateKHR)
+            vkGetDeviceProcAddr(Device, "vkDestroyDescriptorUpdateTemplateKHR");
+        UpdateDescriptorSetWithTemplateFn = (PFN_vkUpdateDescriptorSetWithTemplateKHR)
+            vkGetDeviceProcAddr(Device, "vkUpdateDescriptorSetWithTemplateKHR");
+    }
+
     for (int type = 0; type < static_cast<int>(EQueueType::Count); type++)
     {
         int queueCount = queueFamilyProperites.at(QueueFamilies[type]).queueCount;
@@ -283,6 +390,8 @@ CDeviceVk::CDeviceVk(EDeviceCreateHints hints)
         for (int i = 0; i < queueCount; i++)
         {
             vkGetDeviceQueue(Device, QueueFamilies[type], i, &Queues[type][i]);
+            if (VkQueueMutexes.find(Queues[type][i]) == VkQueueMutexes.end())
+                VkQueueMutexes.emplace(Queues[type][i], std::make_unique<std::mutex>());
         }
     }
 
@@ -296,28 +405,79 @@ CDeviceVk::CDeviceVk(EDeviceCreateHints hints)
     vkCreatePipelineCache(Device, &pipelineCacheInfo, nullptr, &PipelineCache);
 
     HugeConstantBuffer = std::make_unique<CPersistentMappedRingBuffer>(
-        *this, 33554432, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT); // 32M
+        *this, options.InitialConstantMemory, EBufferUsageFlags::Uniform,
+        EMemoryCategory::ConstantRing);
+    TransientBuffer = std::make_unique<CPersistentMappedRingBuffer>(
+        *this, options.InitialTransientMemory,
+        EBufferUsageFlags::Vertex | EBufferUsageFlags::Index | EBufferUsageFlags::IndirectDraw
+            | EBufferUsageFlags::Storage,
+        EMemoryCategory::TransientRing);
+    BufferHeap = std::make_unique<CBufferHeapVk>(*this);
+    // Before anything movable is created
+    if (options.bEnableDefragmentation)
+        Defragmenter = std::make_unique<CDefragmenterVk>(*this);
+    DescriptorSetCache = std::make_unique<CDescriptorSetCacheVk>(*this);
+    StateCache = std::make_unique<CStateCacheVk>(*this);
+    TransientDescriptorPool = std::make_unique<CTransientDescriptorPoolVk>(*this);
 
     DefaultRenderQueue =
         std::static_pointer_cast<CCommandQueueVk>(CreateCommandQueue(EQueueType::Render));
-    if (!IsTransferQueueSeparate())
-        DefaultCopyQueue = DefaultRenderQueue;
+    // Internal uploads rely on executing in order with rendering, so they stay on the render
+    //   queue. Use CreateCommandQueue(EQueueType::Copy) and WaitFor for async uploads
+    DefaultCopyQueue = DefaultRenderQueue;
+    UploadManager = std::make_unique<CUploadManagerVk>(*this);
+    MipGenerator = std::make_unique<CMipGeneratorVk>(*this);
+    ReadbackPool = std::make_unique<CReadbackPoolVk>(*this);
 }
 
 CDeviceVk::~CDeviceVk()
 {
+    // Submits and waits for anything still pending, needs the queues
+    UploadManager.reset();
+    MipGenerator.reset();
+    ReadbackPool.reset();
     DefaultCopyQueue.reset();
     DefaultRenderQueue.reset();
+    BindlessHeap.reset();
+    StateCache.reset();
+    DescriptorSetCache.reset();
+    TransientDescriptorPool.reset();
     HugeConstantBuffer.reset();
+    TransientBuffer.reset();
+    BufferHeap.reset();
+    Defragmenter.reset();
     vkDestroyPipelineCache(Device, PipelineCache, nullptr);
     vmaDestroyAllocator(Allocator);
     vkDestroyDevice(Device, nullptr);
 }
 
+// Down to 1x1x1, NPOT sizes round down at every level like Vulkan does
+static uint32_t GetMipChainLength(uint32_t width, uint32_t height, uint32_t depth)
+{
+    uint32_t largest = std::max(width, std::max(height, depth));
+    return 1 + static_cast<uint32_t>(floor(log2(largest)));
+}
+
 CImage::Ref CDeviceVk::InternalCreateImage(VkImageType type, EFormat format, EImageUsageFlags usage,
                                            uint32_t width, uint32_t height, uint32_t depth,
                                            uint32_t mipLevels, uint32_t arrayLayers,
                                            uint32_t sampleCount, const void* initialData)
+{
+    std::vector<CImageSubresourceData> subresources;
+    if (initialData)
+    {
+        size_t dataSize = GetFormatInfo(format).GetImageSize(width, height, depth);
+        subresources.push_back({ initialData, dataSize, 0, 0 });
+    }
+    return InternalCreateImage(type, format, usage, width, height, depth, mipLevels, arrayLayers,
+                               sampleCount, subresources);
+}
+
+CImage::Ref
+CDeviceVk::InternalCreateImage(VkImageType type, EFormat format, EImageUsageFlags usage,
+                               uint32_t width, uint32_t height, uint32_t depth, uint32_t mipLevels,
+                               uint32_t arrayLayers, uint32_t sampleCount,
+                               const std::vector<CImageSubresourceData>& initialData)
 {
     VkImageCreateInfo imageInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
     imageInfo.imageType = type;
@@ -330,13 +490,15 @@ CImage::Ref CDeviceVk::InternalCreateImage(VkImageType type, EFormat format, EIm
     imageInfo.samples = static_cast<VkSampleCountFlagBits>(sampleCount);
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL; // BELOW
     imageInfo.usage = 0; // BELOW
-    if (IsTransferQueueSeparate())
+    if (UniqueQueueFamilies.size() > 1)
     {
         imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-        imageInfo.queueFamilyIndexCount = 3;
-        imageInfo.pQueueFamilyIndices = QueueFamilies;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(UniqueQueueFamilies.size());
+        imageInfo.pQueueFamilyIndices = UniqueQueueFamilies.data();
     }
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (Any(usage, EImageUsageFlags::CubeMap))
+        imageInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 
     // Allocate memory using the Vulkan Memory Allocator (unless memFlags has the NO_ALLOCATION bit
     // set).
@@ -377,9 +539,17 @@ CImage::Ref CDeviceVk::InternalCreateImage(VkImageType type, EFormat format, EIm
         allocCreateInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
         defaultState = EResourceState::CopySource;
     }
+    bool bComputeMips = false;
     if (Any(usage, EImageUsageFlags::GenMIPMaps))
     {
+        // Neither the blits nor the compute shader can write block compressed texels
+        if (GetFormatInfo(format).IsCompressed())
+            throw CRHIRuntimeError("GenMIPMaps can't be used with compressed formats");
         imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        bComputeMips = mipLevels > 1
+            && MipGenerator->IsSupported(imageInfo.imageType, imageInfo.format, sampleCount);
+        if (bComputeMips)
+            imageInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
     }
 
     VkResult result;
@@ -391,50 +561,38 @@ CImage::Ref CDeviceVk::InternalCreateImage(VkImageType type, EFormat format, EIm
     auto image =
         std::make_shared<CMemoryImageVk>(*this, handle, allocation, imageInfo, usage, defaultState);
 
-    auto cmdList = DefaultCopyQueue->CreateCommandList();
-    cmdList->Enqueue();
-    auto ctx = std::static_pointer_cast<CCommandContextVk>(cmdList->CreateCopyContext());
-    auto cmdBuffer = ctx->GetCmdBuffer();
-    if (initialData)
-    {
-        ctx->TransitionImage(*image, EResourceState::CopyDest);
-
-        // Prepare a staging buffer
-        VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-        bufferInfo.size = GetUncompressedImageFormatSize(imageInfo.format)
-            * static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth);
-        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-
-        VmaAllocationCreateInfo allocInfo = {};
-        allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    // Image copies need the buffer offset to be a multiple of both 4 and the texel or block size
+    size_t blockSize = std::max<size_t>(GetFormatInfo(format).BytesPerBlock, 1);
+    size_t alignment = blockSize * 4 / std::gcd(blockSize, size_t(4));
 
-        VkBuffer stagingBuffer = VK_NULL_HANDLE;
-        VmaAllocation stagingAlloc = VK_NULL_HANDLE;
+    // Every piece moves the image into CopyDest itself, a batch may be submitted in between
+    auto recordCopy = [=](CCommandContextVk& ctx, VkBuffer staging, size_t offset,
+                          const CImageSubresourceData& sub) {
+        ctx.TransitionImage(*image, EResourceState::CopyDest);
 
-        vmaCreateBuffer(Allocator, &bufferInfo, &allocInfo, &stagingBuffer, &stagingAlloc, nullptr);
-
-        void* mappedData;
-        vmaMapMemory(Allocator, stagingAlloc, &mappedData);
-        memcpy(mappedData, initialData, bufferInfo.size);
-        vmaUnmapMemory(Allocator, stagingAlloc);
-
-        // Synchronously copy the content
         VkBufferImageCopy region = {};
-        region.bufferOffset = 0;
+        region.bufferOffset = offset;
         region.bufferRowLength = 0;
         region.bufferImageHeight = 0;
 
         region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.mipLevel = sub.MipLevel;
+        region.imageSubresource.baseArrayLayer = sub.ArrayLayer;
         region.imageSubresource.layerCount = 1;
 
         region.imageOffset = { 0, 0, 0 };
-        region.imageExtent = { width, height, depth };
-        vkCmdCopyBufferToImage(cmdBuffer, stagingBuffer, handle,
+        region.imageExtent = { std::max(width >> sub.MipLevel, 1u),
+                               std::max(height >> sub.MipLevel, 1u),
+                               std::max(depth >> sub.MipLevel, 1u) };
+        vkCmdCopyBufferToImage(ctx.GetCmdBuffer(), staging, handle,
                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    };
 
-        if (Any(usage, EImageUsageFlags::GenMIPMaps))
+    bool bHasData = !initialData.empty();
+    auto recordFinish = [=](CCommandContextVk& ctx) {
+        if (bHasData && bComputeMips)
+            MipGenerator->Generate(ctx, image);
+        else if (bHasData && Any(usage, EImageUsageFlags::GenMIPMaps))
         {
             CImageBlit blit;
             blit.SrcSubresource.BaseArrayLayer = 0;
@@ -460,17 +618,31 @@ CImage::Ref CDeviceVk::InternalCreateImage(VkImageType type, EFormat format, EIm
                 if (srcDepth > 1)
                     srcDepth /= 2;
                 blit.DstOffsets[1].Set(srcWidth, srcHeight, srcDepth);
-                ctx->BlitImage(*image, *image, { blit }, EFilter::Linear);
+                ctx.BlitImage(*image, *image, { blit }, EFilter::Linear);
             }
         }
+        ctx.TransitionImage(*image, defaultState);
+    };
 
-        PostFrameCleanup.emplace_back(
-            [=](CDeviceVk& p) { vmaDestroyBuffer(p.GetAllocator(), stagingBuffer, stagingAlloc); });
+    // The access tracker points at the image until the batch is submitted. Even without data the
+    //   image has to be brought into its default state
+    if (!bHasData)
+    {
+        UploadManager->Upload(
+            nullptr, 0, alignment,
+            [=](CCommandContextVk& ctx, VkBuffer, size_t) { recordFinish(ctx); }, image);
+    }
+    for (size_t i = 0; i < initialData.size(); i++)
+    {
+        const CImageSubresourceData& sub = initialData[i];
+        bool bLast = i + 1 == initialData.size();
+        auto record = [=](CCommandContextVk& ctx, VkBuffer staging, size_t offset) {
+            recordCopy(ctx, staging, offset, sub);
+            if (bLast)
+                recordFinish(ctx);
+        };
+        UploadManager->Upload(sub.Data, sub.Size, alignment, record, image);
     }
-    ctx->TransitionImage(*image, defaultState);
-    ctx->FinishRecording();
-    cmdList->Commit();
-    DefaultCopyQueue->Flush();
 
     if (usage == EImageUsageFlags::Sampled)
         image->SetTrackingDisabled(true);
@@ -483,16 +655,39 @@ CBuffer::Ref CDeviceVk::CreateBuffer(size_t size, EBufferUsageFlags usage, const
     return std::make_shared<CBufferVk>(*this, size, usage, initialData);
 }
 
+CTransientAllocation CDeviceVk::AllocateTransient(size_t size, EBufferUsageFlags usage)
+{
+    // Every page can be bound as any of these, usage only decides the alignment
+    size_t alignment = 16;
+    if (Any(usage, EBufferUsageFlags::Storage))
+        alignment = std::max<size_t>(alignment, Properties.limits.minStorageBufferOffsetAlignment);
+    if (Any(usage, EBufferUsageFlags::Uniform) || Any(usage, EBufferUsageFlags::UniformTexel)
+        || Any(usage, EBufferUsageFlags::StorageTexel))
+        throw CRHIRuntimeError("Transient memory is for vertex, index, indirect and storage data");
+
+    CTransientAllocation result;
+    CBufferVk::Ref buffer;
+    result.Data = TransientBuffer->Allocate(size, alignment, buffer, result.Offset);
+    if (!result.Data)
+        throw CRHIRuntimeError("Out of memory for transient buffers");
+    result.Buffer = std::move(buffer);
+    return result;
+}
+
+uint64_t CDeviceVk::FlushUploads() { return UploadManager->Flush(); }
+
+bool CDeviceVk::IsUploadComplete(uint64_t token) { return UploadManager->IsComplete(token); }
+
+void CDeviceVk::WaitForUpload(uint64_t token) { UploadManager->Wait(token); }
+
+CUploadStats CDeviceVk::GetUploadStats() const { return UploadManager->GetStats(); }
+
 CImage::Ref CDeviceVk::CreateImage1D(EFormat format, EImageUsageFlags usage, uint32_t width,
                                      uint32_t mipLevels, uint32_t arrayLayers, uint32_t sampleCount,
                                      const void* initialData)
 {
     if (Any(usage, EImageUsageFlags::GenMIPMaps))
-    {
-        if ((width & -width) != width)
-            throw CRHIRuntimeError("GenMIPMaps requires sizes to be 2^n");
-        mipLevels = 1 + static_cast<uint32_t>(floor(log2(width)));
-    }
+        mipLevels = GetMipChainLength(width, 1, 1);
     return InternalCreateImage(VK_IMAGE_TYPE_1D, format, usage, width, 1, 1, mipLevels, arrayLayers,
                                sampleCount, initialData);
 }
@@ -502,11 +697,7 @@ CImage::Ref CDeviceVk::CreateImage2D(EFormat format, EImageUsageFlags usage, uin
                                      uint32_t sampleCount, const void* initialData)
 {
     if (Any(usage, EImageUsageFlags::GenMIPMaps))
-    {
-        if ((width & -width) != width || (height & -height) != height)
-            throw CRHIRuntimeError("GenMIPMaps requires sizes to be 2^n");
-        mipLevels = 1 + static_cast<uint32_t>(floor(log2(std::min(width, height))));
-    }
+        mipLevels = GetMipChainLength(width, height, 1);
     return InternalCreateImage(VK_IMAGE_TYPE_2D, format, usage, width, height, 1, mipLevels,
                                arrayLayers, sampleCount, initialData);
 }
@@ -517,16 +708,46 @@ CImage::Ref CDeviceVk::CreateImage3D(EFormat format, EImageUsageFlags usage, uin
                                      const void* initialData)
 {
     if (Any(usage, EImageUsageFlags::GenMIPMaps))
-    {
-        if ((width & -width) != width || (height & -height) != height || (depth & -depth) != depth)
-            throw CRHIRuntimeError("GenMIPMaps requires sizes to be 2^n");
-        mipLevels =
-            1 + static_cast<uint32_t>(floor(log2(std::min(width, std::min(height, depth)))));
-    }
+        mipLevels = GetMipChainLength(width, height, depth);
     return InternalCreateImage(VK_IMAGE_TYPE_3D, format, usage, width, height, depth, mipLevels,
                                arrayLayers, sampleCount, initialData);
 }
 
+CImage::Ref CDeviceVk::CreateImageFromFile(const std::string& path, EImageUsageFlags usage)
+{
+    CTextureFile file(path);
+
+    VkImageType type = VK_IMAGE_TYPE_2D;
+    if (file.GetType() == EImageType::Image1D)
+        type = VK_IMAGE_TYPE_1D;
+    else if (file.GetType() == EImageType::Image3D)
+        type = VK_IMAGE_TYPE_3D;
+    if (file.IsCubeMap())
+        usage = usage | EImageUsageFlags::CubeMap;
+
+    uint32_t width = file.GetWidth();
+    uint32_t height = file.GetHeight();
+    uint32_t depth = file.GetDepth();
+    uint32_t mipLevels = file.GetMipLevels();
+    if (mipLevels > 1)
+    {
+        // The file's own mips win over generated ones
+        uint32_t genMips = static_cast<uint32_t>(EImageUsageFlags::GenMIPMaps);
+        usage = static_cast<EImageUsageFlags>(static_cast<uint32_t>(usage) & ~genMips);
+    }
+    else if (Any(usage, EImageUsageFlags::GenMIPMaps))
+        mipLevels = GetMipChainLength(width, height, depth);
+
+    std::vector<CImageSubresourceData> subresources;
+    subresources.reserve(file.GetSubresources().size());
+    for (const auto& sub : file.GetSubresources())
+        subresources.push_back({ file.GetData() + sub.Offset, sub.Size, sub.MipLevel,
+                                 sub.ArrayLayer });
+    // Everything is copied into staging before this returns, the file can be unmapped after
+    return InternalCreateImage(type, file.GetFormat(), usage, width, height, depth, mipLevels,
+                               file.GetArrayLayers(), 1, subresources);
+}
+
 CImageView::Ref CDeviceVk::CreateImageView(const CImageViewDesc& desc, CImage::Ref image)
 {
     return std::make_shared<CImageViewVk>(*this, desc, std::static_pointer_cast<CImageVk>(image));
@@ -538,15 +759,176 @@ CShaderModule::Ref CDeviceVk::CreateShaderModule(size_t size, const void* pCode)
 }
 
 CDescriptorSetLayout::Ref
-CDeviceVk::CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings)
+CDeviceVk::CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings,
+                                     bool bPushDescriptors)
+{
+    return StateCache->FindOrCreate(bindings, bPushDescriptors);
+}
+
+CBindlessHeap::Ref CDeviceVk::GetBindlessHeap()
+{
+    std::lock_guard<std::mutex> lk(DeviceMutex);
+    if (!BindlessHeap)
+        BindlessHeap = std::make_shared<CBindlessHeapVk>(*this);
+    return BindlessHeap;
+}
+
+VkDescriptorUpdateTemplateKHR
+CDeviceVk::CreateDescriptorUpdateTemplate(const VkDescriptorUpdateTemplateCreateInfoKHR& info)
 {
-    return std::make_shared<CDescriptorSetLayoutVk>(*this, bindings);
+    if (!CreateDescriptorUpdateTemplateFn)
+        return VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplateKHR handle = VK_NULL_HANDLE;
+    VK(CreateDescriptorUpdateTemplateFn(Device, &info, nullptr, &handle));
+    return handle;
+}
+
+void CDeviceVk::DestroyDescriptorUpdateTemplate(VkDescriptorUpdateTemplateKHR updateTemplate)
+{
+    if (updateTemplate)
+        DestroyDescriptorUpdateTemplateFn(Device, updateTemplate, nullptr);
+}
+
+void CDeviceVk::UpdateDescriptorSetWithTemplate(VkDescriptorSet set,
+                                                VkDescriptorUpdateTemplateKHR updateTemplate,
+                                                const void* data)
+{
+    UpdateDescriptorSetWithTemplateFn(Device, set, updateTemplate, data);
+}
+
+void CDeviceVk::CmdPushDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint,
+                                     VkPipelineLayout layout, uint32_t set, uint32_t writeCount,
+                                     const VkWriteDescriptorSet* writes)
+{
+    CmdPushDescriptorSetFn(cmdBuffer, bindPoint, layout, set, writeCount, writes);
+}
+
+void CDeviceVk::CountPushedSet(uint32_t descriptorCount)
+{
+    PushedSets.fetch_add(1, std::memory_order_relaxed);
+    PushedDescriptors.fetch_add(descriptorCount, std::memory_order_relaxed);
+}
+
+void CDeviceVk::CountBoundSet() { BoundSets.fetch_add(1, std::memory_order_relaxed); }
+
+CDescriptorStats CDeviceVk::GetDescriptorStats() const
+{
+    CDescriptorStats stats;
+    stats.PushedSets = PushedSets.load(std::memory_order_relaxed);
+    stats.PushedDescriptors = PushedDescriptors.load(std::memory_order_relaxed);
+    stats.BoundSets = BoundSets.load(std::memory_order_relaxed);
+    return stats;
+}
+
+CConstantMemoryStats CDeviceVk::GetConstantMemoryStats() const
+{
+    return HugeConstantBuffer->GetStats();
+}
+
+CMemoryStats CDeviceVk::GetMemoryStats() const
+{
+    VmaStats vmaStats;
+    vmaCalculateStats(Allocator, &vmaStats);
+    const VkPhysicalDeviceMemoryProperties* memoryProps;
+    vmaGetMemoryProperties(Allocator, &memoryProps);
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT
+    };
+    if (GetMemoryProperties2Fn)
+    {
+        VkPhysicalDeviceMemoryProperties2KHR props2 = {
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR
+        };
+        props2.pNext = &budget;
+        GetMemoryProperties2Fn(PhysicalDevice, &props2);
+    }
+
+    CMemoryStats stats;
+    for (uint32_t i = 0; i < memoryProps->memoryHeapCount; i++)
+    {
+        const VmaStatInfo& info = vmaStats.memoryHeap[i];
+        CMemoryHeapStats heap;
+        heap.Size = memoryProps->memoryHeaps[i].size;
+        heap.bDeviceLocal =
+            (memoryProps->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        heap.BlockBytes = info.usedBytes + info.unusedBytes;
+        heap.AllocatedBytes = info.usedBytes;
+        heap.Budget = GetMemoryProperties2Fn ? budget.heapBudget[i] : heap.Size;
+        heap.Usage = GetMemoryProperties2Fn ? budget.heapUsage[i] : heap.BlockBytes;
+        stats.Heaps.push_back(heap);
+    }
+
+    for (size_t i = 0; i < static_cast<size_t>(EMemoryCategory::Count); i++)
+    {
+        stats.Categories[i].Allocations = CategoryAllocations[i].load(std::memory_order_relaxed);
+        stats.Categories[i].Bytes = CategoryBytes[i].load(std::memory_order_relaxed);
+    }
+
+    const VmaStatInfo& total = vmaStats.total;
+    stats.BlockCount = total.blockCount;
+    stats.AllocationCount = total.allocationCount;
+    stats.UnusedBytes = total.unusedBytes;
+    stats.UnusedRangeCount = total.unusedRangeCount;
+    stats.LargestUnusedRange = total.unusedRangeCount > 0 ? total.unusedRangeSizeMax : 0;
+    if (stats.UnusedBytes > 0)
+        stats.Fragmentation =
+            1.0f - static_cast<float>(stats.LargestUnusedRange) / stats.UnusedBytes;
+    return stats;
+}
+
+CDefragmentStats CDeviceVk::Defragment(const CDefragmentOptions& options)
+{
+    if (!Defragmenter)
+        throw CRHIRuntimeError("Defragmentation is not enabled on this device");
+    return Defragmenter->Step(options);
+}
+
+void CDeviceVk::CountAllocation(EMemoryCategory category, VmaAllocation allocation)
+{
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(Allocator, allocation, &info);
+    CategoryAllocations[static_cast<size_t>(category)]++;
+    CategoryBytes[static_cast<size_t>(category)] += info.size;
+}
+
+void CDeviceVk::CountFree(EMemoryCategory category, VmaAllocation allocation)
+{
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(Allocator, allocation, &info);
+    CategoryAllocations[static_cast<size_t>(category)]--;
+    CategoryBytes[static_cast<size_t>(category)] -= info.size;
+}
+
+uint32_t CDeviceVk::GetBindlessCapacity(VkDescriptorType type) const
+{
+    if (!bSupportsDescriptorIndexing)
+        throw CRHIRuntimeError("Unbounded descriptor arrays need VK_EXT_descriptor_indexing");
+
+    // Capped to keep the heap's memory reasonable
+    const auto& props = DescriptorIndexingProperties;
+    switch (type)
+    {
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        return std::min({ props.maxDescriptorSetUpdateAfterBindSampledImages,
+                          props.maxPerStageDescriptorUpdateAfterBindSampledImages, 16384u });
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        return std::min({ props.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                          props.maxPerStageDescriptorUpdateAfterBindStorageBuffers, 16384u });
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+        return std::min({ props.maxDescriptorSetUpdateAfterBindSamplers,
+                          props.maxPerStageDescriptorUpdateAfterBindSamplers, 2048u });
+    default:
+        throw CRHIRuntimeError(
+            "Unbounded arrays are only supported for sampled images, storage buffers and samplers");
+    }
 }
 
 CPipelineLayout::Ref
-CDeviceVk::CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts)
+CDeviceVk::CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+                                const std::vector<CPushConstantRange>& pushConstantRanges)
 {
-    return std::make_shared<CPipelineLayoutVk>(*this, setLayouts);
+    return StateCache->FindOrCreate(setLayouts, pushConstantRanges);
 }
 
 CRenderPass::Ref CDeviceVk::CreateRenderPass(const CRenderPassDesc& desc)
@@ -566,14 +948,55 @@ CPipeline::Ref CDeviceVk::CreateComputePipeline(const CComputePipelineDesc& desc
 
 CSampler::Ref CDeviceVk::CreateSampler(const CSamplerDesc& desc)
 {
-    return std::make_shared<CSamplerVk>(*this, desc);
+    return StateCache->FindOrCreate(desc);
 }
 
 CCommandQueue::Ref CDeviceVk::CreateCommandQueue() { return DefaultRenderQueue; }
 
 CCommandQueue::Ref CDeviceVk::CreateCommandQueue(EQueueType queueType)
 {
-    return std::make_shared<CCommandQueueVk>(*this, queueType, GetVkQueue(queueType));
+    const auto& queues = Queues[static_cast<int>(queueType)];
+    uint32_t index = NextQueueIndex[static_cast<int>(queueType)]++ % queues.size();
+    auto queue = std::make_shared<CCommandQueueVk>(*this, queueType, queues[index]);
+    std::lock_guard<std::mutex> lk(DeviceMutex);
+    CommandQueues.push_back(queue);
+    return queue;
+}
+
+std::vector<CCommandQueueVk::Ref> CDeviceVk::GetCommandQueues()
+{
+    std::lock_guard<std::mutex> lk(DeviceMutex);
+    std::vector<CCommandQueueVk::Ref> result;
+    auto iter = CommandQueues.begin();
+    while (iter != CommandQueues.end())
+    {
+        if (auto queue = iter->lock())
+        {
+            result.push_back(std::move(queue));
+            ++iter;
+        }
+        else
+            iter = CommandQueues.erase(iter);
+    }
+    return result;
+}
+
+CQueueCaps CDeviceVk::GetQueueCaps(EQueueType queueType) const
+{
+    uint32_t family = GetQueueFamily(queueType);
+    VkQueueFlags flags = QueueFamilyProperties.at(family).queueFlags;
+
+    CQueueCaps caps;
+    caps.HardwareQueueCount = static_cast<uint32_t>(Queues[static_cast<int>(queueType)].size());
+    caps.bIsDedicated = queueType == EQueueType::Render
+        || family != GetQueueFamily(EQueueType::Render);
+    caps.bSupportsRender = (flags & VK_QUEUE_GRAPHICS_BIT) != 0;
+    caps.bSupportsCompute = (flags & VK_QUEUE_COMPUTE_BIT) != 0;
+    // Graphics and compute queues implicitly support transfer
+    caps.bSupportsCopy = (flags
+                          & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+        != 0;
+    return caps;
 }
 
 CSwapChain::Ref CDeviceVk::CreateSwapChain(const CPresentationSurfaceDesc& info, EFormat format)
@@ -1,34 +1,59 @@
 #pragma once
 #include "Device.h"
 
+#include "BindlessHeapVk.h"
 #include "BufferVk.h"
 #include "CommandContextVk.h"
 #include "CommandQueueVk.h"
+#include "DefragmenterVk.h"
 #include "DescriptorSet.h"
+#include "DescriptorSetCacheVk.h"
+#include "MipGeneratorVk.h"
+#include "ReadbackVk.h"
+#include "StateCacheVk.h"
+#include "TransientDescriptorPoolVk.h"
+#include "UploadManagerVk.h"
 #include "VkCommon.h"
 
+#include <atomic>
 #include <mutex>
 #include <queue>
+#include <unordered_map>
+#include <vector>
 
 namespace RHI
 {
 
+// Initial contents of one mip of one array layer, rows tightly packed
+struct CImageSubresourceData
+{
+    const void* Data;
+    size_t Size;
+    uint32_t MipLevel;
+    uint32_t ArrayLayer;
+};
+
 class CDeviceVk : public CDevice
 {
 public:
     typedef std::shared_ptr<CDeviceVk> Ref;
 
-    explicit CDeviceVk(EDeviceCreateHints hints);
+    CDeviceVk(EDeviceCreateHints hints, const CDeviceCreateOptions& options);
     ~CDeviceVk() override;
 
     CImage::Ref InternalCreateImage(VkImageType type, EFormat format, EImageUsageFlags usage,
                                     uint32_t width, uint32_t height, uint32_t depth,
                                     uint32_t mipLevels, uint32_t arrayLayers, uint32_t sampleCount,
                                     const void* initialData);
+    CImage::Ref InternalCreateImage(VkImageType type, EFormat format, EImageUsageFlags usage,
+                                    uint32_t width, uint32_t height, uint32_t depth,
+                                    uint32_t mipLevels, uint32_t arrayLayers, uint32_t sampleCount,
+                                    const std::vector<CImageSubresourceData>& initialData);
 
     // Resources and resource views
     CBuffer::Ref CreateBuffer(size_t size, EBufferUsageFlags usage,
                               const void* initialData = nullptr);
+    CTransientAllocation AllocateTransient(size_t size, EBufferUsageFlags usage);
     CImage::Ref CreateImage1D(EFormat format, EImageUsageFlags usage, uint32_t width,
                               uint32_t mipLevels = 1, uint32_t arrayLayers = 1,
                               uint32_t sampleCount = 1, const void* initialData = nullptr);
@@ -39,14 +64,22 @@ public:
                               uint32_t height, uint32_t depth, uint32_t mipLevels = 1,
                               uint32_t arrayLayers = 1, uint32_t sampleCount = 1,
                               const void* initialData = nullptr);
+    CImage::Ref CreateImageFromFile(const std::string& path, EImageUsageFlags usage);
     CImageView::Ref CreateImageView(const CImageViewDesc& desc, CImage::Ref image);
+    uint64_t FlushUploads();
+    bool IsUploadComplete(uint64_t token);
+    void WaitForUpload(uint64_t token);
+    CUploadStats GetUploadStats() const;
 
     // Shader and resource binding
     CShaderModule::Ref CreateShaderModule(size_t size, const void* pCode);
     CDescriptorSetLayout::Ref
-    CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings);
+    CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings,
+                              bool bPushDescriptors = false);
     CPipelineLayout::Ref
-    CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts);
+    CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+                         const std::vector<CPushConstantRange>& pushConstantRanges = {});
+    CBindlessHeap::Ref GetBindlessHeap();
 
     // States
     CRenderPass::Ref CreateRenderPass(const CRenderPassDesc& desc);
@@ -57,6 +90,11 @@ public:
     // Command submission
     CCommandQueue::Ref CreateCommandQueue();
     CCommandQueue::Ref CreateCommandQueue(EQueueType queueType);
+    CQueueCaps GetQueueCaps(EQueueType queueType) const;
+    CDescriptorStats GetDescriptorStats() const;
+    CConstantMemoryStats GetConstantMemoryStats() const;
+    CMemoryStats GetMemoryStats() const;
+    CDefragmentStats Defragment(const CDefragmentOptions& options);
 
     CSwapChain::Ref CreateSwapChain(const CPresentationSurfaceDesc& info, EFormat format);
     void WaitIdle();
@@ -66,6 +104,24 @@ public:
     VkDevice GetVkDevice() const { return Device; }
     VkPhysicalDevice GetVkPhysicalDevice() const { return PhysicalDevice; }
     const VkPhysicalDeviceLimits& GetVkLimits() const { return Properties.limits; }
+    bool SupportsDescriptorIndexing() const { return bSupportsDescriptorIndexing; }
+    // How big an unbounded array of the given type gets
+    uint32_t GetBindlessCapacity(VkDescriptorType type) const;
+    // VK_KHR_descriptor_update_template, creation returns null if the extension is missing
+    VkDescriptorUpdateTemplateKHR
+    CreateDescriptorUpdateTemplate(const VkDescriptorUpdateTemplateCreateInfoKHR& info);
+    void DestroyDescriptorUpdateTemplate(VkDescriptorUpdateTemplateKHR updateTemplate);
+    void UpdateDescriptorSetWithTemplate(VkDescriptorSet set,
+                                         VkDescriptorUpdateTemplateKHR updateTemplate,
+                                         const void* data);
+    // VK_KHR_push_descriptor, 0 if the extension is missing
+    uint32_t GetMaxPushDescriptors() const { return MaxPushDescriptors; }
+    void CmdPushDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint,
+                              VkPipelineLayout layout, uint32_t set, uint32_t writeCount,
+                              const VkWriteDescriptorSet* writes);
+    // Bumped by the command contexts as they bind sets
+    void CountPushedSet(uint32_t descriptorCount);
+    void CountBoundSet();
 
     // Otherwise transfer and graphics are the same queue
     bool IsTransferQueueSeparate() const
@@ -80,16 +136,39 @@ public:
     // Getters for global objects
     uint32_t GetQueueFamily(EQueueType t) const { return QueueFamilies[static_cast<int>(t)]; }
     VkQueue GetVkQueue(EQueueType t) const { return Queues[static_cast<int>(t)][0]; }
+    // Distinct families in use, for resources created with VK_SHARING_MODE_CONCURRENT
+    const std::vector<uint32_t>& GetUniqueQueueFamilies() const { return UniqueQueueFamilies; }
+    // Several CCommandQueueVk can share a VkQueue, which requires external synchronization
+    std::mutex& GetVkQueueMutex(VkQueue queue) const { return *VkQueueMutexes.at(queue); }
     VmaAllocator GetAllocator() const { return Allocator; }
 
     CPersistentMappedRingBuffer* GetHugeConstantBuffer() const { return HugeConstantBuffer.get(); }
+    CPersistentMappedRingBuffer* GetTransientBuffer() const { return TransientBuffer.get(); }
+    CBufferHeapVk* GetBufferHeap() const { return BufferHeap.get(); }
+    CDescriptorSetCacheVk* GetDescriptorSetCache() const { return DescriptorSetCache.get(); }
+    CTransientDescriptorPoolVk* GetTransientDescriptorPool() const
+    {
+        return TransientDescriptorPool.get();
+    }
+    CUploadManagerVk* GetUploadManager() const { return UploadManager.get(); }
+    CMipGeneratorVk* GetMipGenerator() const { return MipGenerator.get(); }
+    CReadbackPoolVk* GetReadbackPool() const { return ReadbackPool.get(); }
+    // Null unless enabled in CDeviceCreateOptions
+    CDefragmenterVk* GetDefragmenter() const { return Defragmenter.get(); }
     VkPipelineCache GetPipelineCache() const { return PipelineCache; }
 
     CCommandQueueVk::Ref GetDefaultRenderQueue() const { return DefaultRenderQueue; }
     CCommandQueueVk::Ref GetDefaultCopyQueue() const { return DefaultCopyQueue; }
+    // Every queue that is still alive, including the default ones
+    std::vector<CCommandQueueVk::Ref> GetCommandQueues();
 
     void AddPostFrameCleanup(std::function<void(CDeviceVk&)> callback);
 
+    // Keep the per category totals of GetMemoryStats, called right after an allocation is made
+    //   and right before it's freed
+    void CountAllocation(EMemoryCategory category, VmaAllocation allocation);
+    void CountFree(EMemoryCategory category, VmaAllocation allocation);
+
 private:
     VkDevice Device;
 
@@ -97,12 +176,40 @@ private:
     //   it's best to stick to one queue per family for current GPUs
     VkPhysicalDevice PhysicalDevice;
     VkPhysicalDeviceProperties Properties;
+    bool bSupportsDescriptorIndexing = false;
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT DescriptorIndexingProperties;
+    PFN_vkCreateDescriptorUpdateTemplateKHR CreateDescriptorUpdateTemplateFn = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR DestroyDescriptorUpdateTemplateFn = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR UpdateDescriptorSetWithTemplateFn = nullptr;
+    uint32_t MaxPushDescriptors = 0;
+    PFN_vkCmdPushDescriptorSetKHR CmdPushDescriptorSetFn = nullptr;
+    std::atomic<uint64_t> PushedSets { 0 };
+    std::atomic<uint64_t> PushedDescriptors { 0 };
+    std::atomic<uint64_t> BoundSets { 0 };
+    // Only set if VK_EXT_memory_budget is enabled
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR GetMemoryProperties2Fn = nullptr;
+    std::atomic<uint64_t> CategoryAllocations[static_cast<size_t>(EMemoryCategory::Count)] {};
+    std::atomic<uint64_t> CategoryBytes[static_cast<size_t>(EMemoryCategory::Count)] {};
 
     // Global objects
     uint32_t QueueFamilies[static_cast<int>(EQueueType::Count)];
     std::vector<VkQueue> Queues[static_cast<int>(EQueueType::Count)];
+    std::vector<uint32_t> UniqueQueueFamilies;
+    std::vector<VkQueueFamilyProperties> QueueFamilyProperties;
+    std::unordered_map<VkQueue, std::unique_ptr<std::mutex>> VkQueueMutexes;
+    std::atomic<uint32_t> NextQueueIndex[static_cast<int>(EQueueType::Count)] {};
     VmaAllocator Allocator;
     std::unique_ptr<CPersistentMappedRingBuffer> HugeConstantBuffer;
+    std::unique_ptr<CPersistentMappedRingBuffer> TransientBuffer;
+    std::unique_ptr<CBufferHeapVk> BufferHeap;
+    std::unique_ptr<CDescriptorSetCacheVk> DescriptorSetCache;
+    std::unique_ptr<CStateCacheVk> StateCache;
+    std::unique_ptr<CTransientDescriptorPoolVk> TransientDescriptorPool;
+    std::unique_ptr<CUploadManagerVk> UploadManager;
+    std::unique_ptr<CMipGeneratorVk> MipGenerator;
+    std::unique_ptr<CReadbackPoolVk> ReadbackPool;
+    std::unique_ptr<CDefragmenterVk> Defragmenter;
+    CBindlessHeapVk::Ref BindlessHeap;
     VkPipelineCache PipelineCache;
     CCommandQueueVk::Ref DefaultRenderQueue;
     CCommandQueueVk::Ref DefaultCopyQueue;
@@ -110,6 +217,7 @@ private:
     friend class CCommandQueueVk; // Allow queues to grab cleanup functors
     std::mutex DeviceMutex;
     std::vector<std::function<void(CDeviceVk&)>> PostFrameCleanup;
+    std::vector<std::weak_ptr<CCommandQueueVk>> CommandQueues;
 };
 
 } /* namespace RHI */
@@ -103,6 +103,8 @@ CImageViewVk::~CImageViewVk()
 {
     if (bIsSwapChainProxy)
         return;
+    if (auto* cache = Parent.GetDescriptorSetCache())
+        cache->Evict(GetHandleKey(ImageView));
     vkDestroyImageView(Parent.GetVkDevice(), ImageView, nullptr);
 }
 
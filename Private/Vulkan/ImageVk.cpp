@@ -212,6 +212,8 @@ CMemoryImageVk::CMemoryImageVk(CDeviceVk& p, VkImage image, VmaAllocation alloc,
     , DefaultState(defaultState)
 {
     InitializeAccess(0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, CreateInfo.initialLayout);
+    if (ImageAlloc)
+        Parent.CountAllocation(GetMemoryCategory(), ImageAlloc);
 }
 
 CMemoryImageVk::~CMemoryImageVk()
@@ -219,7 +221,20 @@ CMemoryImageVk::~CMemoryImageVk()
     if (!ImageAlloc)
         vkDestroyImage(Parent.GetVkDevice(), Image, nullptr);
     else
+    {
+        Parent.CountFree(GetMemoryCategory(), ImageAlloc);
         vmaDestroyImage(Parent.GetAllocator(), Image, ImageAlloc);
+    }
+}
+
+EMemoryCategory CMemoryImageVk::GetMemoryCategory() const
+{
+    if (Any(UsageFlags, EImageUsageFlags::RenderTarget)
+        || Any(UsageFlags, EImageUsageFlags::DepthStencil))
+        return EMemoryCategory::RenderTargets;
+    if (Any(UsageFlags, EImageUsageFlags::Staging))
+        return EMemoryCategory::Staging;
+    return EMemoryCategory::Images;
 }
 
 EImageUsageFlags CMemoryImageVk::GetUsageFlags() const { return UsageFlags; }
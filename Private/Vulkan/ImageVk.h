@@ -93,6 +93,8 @@ public:
     EResourceState GetDefaultState() const;
 
 private:
+    EMemoryCategory GetMemoryCategory() const;
+
     CDeviceVk& Parent;
 
     VkImage Image = VK_NULL_HANDLE;
@@ -0,0 +1,120 @@
+#include "MipGeneratorVk.h"
+#include "CommandContextVk.h"
+#include "DeviceVk.h"
+#include <algorithm>
+#include <vector>
+
+// Checked in and regenerated by the build when glslangValidator is found. Without it mips are
+//   left to blits
+#if __has_include("Shaders/GenMips.spv.h")
+#include "Shaders/GenMips.spv.h"
+#define RHI_HAS_GEN_MIPS_SPV
+#endif
+
+namespace RHI
+{
+
+CMipGeneratorVk::CMipGeneratorVk(CDeviceVk& p)
+    : Parent(p)
+{
+    // The device enables every feature it has
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(Parent.GetVkPhysicalDevice(), &features);
+    bSupportsWriteWithoutFormat = features.shaderStorageImageWriteWithoutFormat == VK_TRUE;
+}
+
+bool CMipGeneratorVk::IsSupported(VkImageType type, VkFormat format, uint32_t sampleCount) const
+{
+#ifndef RHI_HAS_GEN_MIPS_SPV
+    return false;
+#endif
+    if (!bSupportsWriteWithoutFormat || type != VK_IMAGE_TYPE_2D || sampleCount != 1)
+        return false;
+
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(Parent.GetVkPhysicalDevice(), format, &props);
+    VkFormatFeatureFlags needed =
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+    return (props.optimalTilingFeatures & needed) == needed;
+}
+
+void CMipGeneratorVk::Generate(CCommandContextVk& ctx, const CImageVk::Ref& image)
+{
+    std::call_once(PipelineOnce, [this]() { CreatePipeline(); });
+
+    uint32_t mipLevels = image->GetMipLevels();
+    uint32_t layers = image->GetArrayLayers();
+    // Storage images sample in GENERAL as well, see CDescriptorSetVk::BindImageView
+    EResourceState srcState = Any(image->GetUsageFlags(), EImageUsageFlags::Storage)
+        ? EResourceState::UnorderedAccess
+        : EResourceState::ShaderResource;
+
+    std::vector<CImageView::Ref> views;
+    std::vector<CDescriptorSet::Ref> sets;
+    ctx.BindComputePipeline(*Pipeline);
+    for (uint32_t srcMip = 0; srcMip + 1 < mipLevels; srcMip += MipsPerDispatch)
+    {
+        uint32_t dstCount = std::min(MipsPerDispatch, mipLevels - 1 - srcMip);
+        auto set = SetLayout->CreateDescriptorSet();
+        views.push_back(CreateMipView(image, srcMip));
+        set->BindImageView(views.back(), 0, 0);
+        for (uint32_t i = 0; i < MipsPerDispatch; i++)
+        {
+            // Every element needs a valid view even though the shader only writes dstCount
+            if (i < dstCount)
+                views.push_back(CreateMipView(image, srcMip + 1 + i));
+            set->BindImageView(views.back(), 1, i);
+        }
+
+        // The previous dispatch wrote the source, the tracker puts a barrier in between
+        ctx.TransitionImage(*image, srcMip, 1, 0, layers, srcState);
+        ctx.TransitionImage(*image, srcMip + 1, dstCount, 0, layers,
+                            EResourceState::UnorderedAccess);
+
+        uint32_t srcWidth = std::max(image->GetWidth() >> srcMip, 1u);
+        uint32_t srcHeight = std::max(image->GetHeight() >> srcMip, 1u);
+        uint32_t params[4] = { srcWidth, srcHeight, dstCount, 0 };
+        ctx.BindComputeDescriptorSet(0, *set);
+        ctx.PushConstants(0, sizeof(params), params);
+
+        uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+        uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+        uint32_t groupsX = (dstWidth + GroupSize - 1) / GroupSize;
+        uint32_t groupsY = (dstHeight + GroupSize - 1) / GroupSize;
+        ctx.Dispatch(groupsX, groupsY, layers);
+        sets.push_back(std::move(set));
+    }
+
+    // The views are destroyed right away otherwise, hold them until the work retires
+    Parent.AddPostFrameCleanup([views, sets](CDeviceVk&) {});
+}
+
+void CMipGeneratorVk::CreatePipeline()
+{
+    SetLayout = Parent.CreateDescriptorSetLayout(
+        {
+            { 0, EDescriptorType::Image, 1, EShaderStageFlags::Compute },
+            { 1, EDescriptorType::StorageImage, MipsPerDispatch, EShaderStageFlags::Compute },
+        },
+        true);
+    PipelineLayout =
+        Parent.CreatePipelineLayout({ SetLayout }, { { EShaderStageFlags::Compute, 0, 16 } });
+
+#ifdef RHI_HAS_GEN_MIPS_SPV
+    CComputePipelineDesc desc;
+    desc.CS = Parent.CreateShaderModule(sizeof(GenMipsSpv), GenMipsSpv);
+    desc.Layout = PipelineLayout;
+    Pipeline = Parent.CreateComputePipeline(desc);
+#endif
+}
+
+CImageView::Ref CMipGeneratorVk::CreateMipView(const CImageVk::Ref& image, uint32_t mip)
+{
+    CImageViewDesc desc;
+    desc.Type = EImageViewType::View2DArray;
+    desc.Format = image->GetFormat();
+    desc.Range.Set(mip, 1, 0, image->GetArrayLayers());
+    return Parent.CreateImageView(desc, image);
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "DescriptorSet.h"
+#include "ImageVk.h"
+#include "Pipeline.h"
+#include "VkCommon.h"
+#include <mutex>
+
+namespace RHI
+{
+
+class CCommandContextVk;
+
+// Fills every mip of an image from mip 0 with a compute shader that writes up to four levels per
+//   dispatch and handles sizes that aren't powers of two. Only 2D images (arrays and cube maps
+//   included) in formats that can be storage images, the rest is left to blits
+class CMipGeneratorVk
+{
+public:
+    explicit CMipGeneratorVk(CDeviceVk& p);
+
+    // Asked before the image is created, since it needs VK_IMAGE_USAGE_STORAGE_BIT
+    bool IsSupported(VkImageType type, VkFormat format, uint32_t sampleCount) const;
+
+    // Leaves mips in a mix of states, the caller transitions the whole image afterwards
+    void Generate(CCommandContextVk& ctx, const CImageVk::Ref& image);
+
+private:
+    static constexpr uint32_t MipsPerDispatch = 4;
+    static constexpr uint32_t GroupSize = 8;
+
+    void CreatePipeline();
+    CImageView::Ref CreateMipView(const CImageVk::Ref& image, uint32_t mip);
+
+    CDeviceVk& Parent;
+    bool bSupportsWriteWithoutFormat = false;
+
+    // Created on first use, most applications never generate mips
+    std::once_flag PipelineOnce;
+    CDescriptorSetLayout::Ref SetLayout;
+    CPipelineLayout::Ref PipelineLayout;
+    CPipeline::Ref Pipeline;
+};
+
+}
@@ -20,6 +20,7 @@ public:
     VkPipeline GetHandle() const { return PipelineHandle; }
 
     VkPipelineLayout GetPipelineLayout() const;
+    const CPipelineLayoutVk& GetPipelineLayoutObject() const { return *PipelineLayout; }
 
 private:
     void AddShaderModule(const CShaderModule::Ref& shaderModule, VkShaderStageFlagBits stage);
@@ -0,0 +1,95 @@
+#include "ReadbackVk.h"
+#include "DeviceVk.h"
+
+namespace RHI
+{
+
+CReadbackPoolVk::CReadbackPoolVk(CDeviceVk& p)
+    : Parent(p)
+{
+}
+
+CBufferVk::Ref CReadbackPoolVk::Acquire(size_t size)
+{
+    size_t bucketSize = GetBucketSize(size);
+    {
+        std::lock_guard<std::mutex> lk(Mutex);
+        auto& bucket = FreeBuffers[bucketSize];
+        if (!bucket.empty())
+        {
+            auto buffer = std::move(bucket.back());
+            bucket.pop_back();
+            PooledBytes -= bucketSize;
+            return buffer;
+        }
+    }
+    return std::make_shared<CBufferVk>(Parent, bucketSize, EBufferUsageFlags::Readback, nullptr);
+}
+
+void CReadbackPoolVk::Release(CBufferVk::Ref buffer)
+{
+    size_t bucketSize = buffer->GetSize();
+    std::lock_guard<std::mutex> lk(Mutex);
+    if (PooledBytes + bucketSize > MaxPooledBytes)
+        return;
+    FreeBuffers[bucketSize].push_back(std::move(buffer));
+    PooledBytes += bucketSize;
+}
+
+size_t CReadbackPoolVk::GetBucketSize(size_t size)
+{
+    size_t bucketSize = MinBucketSize;
+    while (bucketSize < size)
+        bucketSize *= 2;
+    return bucketSize;
+}
+
+CReadbackVk::CReadbackVk(CCommandListVk::Ref cmdList, CBufferVk::Ref buffer, size_t size)
+    : CmdList(std::move(cmdList))
+    , Queue(std::static_pointer_cast<CCommandQueueVk>(CmdList->GetQueue().shared_from_this()))
+    , Buffer(std::move(buffer))
+    , Size(size)
+{
+}
+
+CReadbackVk::~CReadbackVk()
+{
+    // Otherwise the GPU may still write to it, let it go through the usual deferred destruction
+    if (bIsReady)
+        Queue->GetDevice().GetReadbackPool()->Release(std::move(Buffer));
+}
+
+bool CReadbackVk::IsReady()
+{
+    if (bIsReady)
+        return true;
+    if (!CmdList->IsSubmitted())
+        return false;
+    if (Value == 0)
+        Value = Queue->Signal();
+    if (Queue->IsComplete(Value))
+        MarkReady();
+    return bIsReady;
+}
+
+void CReadbackVk::Wait()
+{
+    if (IsReady())
+        return;
+    if (!CmdList->IsSubmitted())
+        throw CRHIRuntimeError("Waited on a readback whose command list wasn't submitted");
+    Queue->Wait(Value);
+    MarkReady();
+}
+
+const void* CReadbackVk::GetData() { return IsReady() ? Data : nullptr; }
+
+void CReadbackVk::MarkReady()
+{
+    // Mapping a Readback buffer invalidates the range, it's usually cached but not coherent
+    Data = Buffer->Map(0, Size);
+    CmdList.reset();
+    bIsReady = true;
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "BufferVk.h"
+#include "CommandListVk.h"
+#include "CommandQueueVk.h"
+#include "CopyContext.h"
+#include "VkCommon.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace RHI
+{
+
+// Readback buffers bucketed by power of two sizes, so a copy that repeats every frame keeps
+//   landing in the same few buffers instead of allocating new ones
+class CReadbackPoolVk
+{
+public:
+    explicit CReadbackPoolVk(CDeviceVk& p);
+
+    // Safe to call from any thread
+    CBufferVk::Ref Acquire(size_t size);
+    // Only for buffers the GPU is done with
+    void Release(CBufferVk::Ref buffer);
+
+private:
+    static constexpr size_t MinBucketSize = 64 * 1024;
+    // Buffers past this are freed instead of pooled
+    static constexpr size_t MaxPooledBytes = 64 * 1024 * 1024;
+
+    static size_t GetBucketSize(size_t size);
+
+    CDeviceVk& Parent;
+    std::mutex Mutex;
+    std::unordered_map<size_t, std::vector<CBufferVk::Ref>> FreeBuffers;
+    size_t PooledBytes = 0;
+};
+
+class CReadbackVk : public CReadback
+{
+public:
+    CReadbackVk(CCommandListVk::Ref cmdList, CBufferVk::Ref buffer, size_t size);
+    ~CReadbackVk() override;
+
+    bool IsReady() override;
+    void Wait() override;
+    const void* GetData() override;
+    size_t GetSize() const override { return Size; }
+
+private:
+    void MarkReady();
+
+    // Dropped once ready
+    CCommandListVk::Ref CmdList;
+    CCommandQueueVk::Ref Queue;
+    CBufferVk::Ref Buffer;
+    size_t Size;
+    const void* Data = nullptr;
+    // 0 until the list has been submitted and a completion value was asked for
+    uint64_t Value = 0;
+    bool bIsReady = false;
+};
+
+}
@@ -1,97 +1,128 @@
 #include "ResourceBindingsVk.h"
+#include "DefragmenterVk.h"
+#include <algorithm>
 
 namespace RHI
 {
 
-void CResourceBindings::Clear(uint32_t set) { BindingsBySet.erase(set); }
+CResourceBindings::CResourceBindings(const CDescriptorSetLayoutVk& layout)
+    : Layout(layout)
+{
+    Slots.resize(Layout.GetSlotCount());
+    BoundMask.resize((Slots.size() + 63) / 64, 0);
+    DirtyMask.resize(BoundMask.size(), 0);
+}
 
-void CResourceBindings::Reset()
+void CResourceBindings::ClearDirtyBits()
 {
-    BindingsBySet.clear();
+    std::fill(DirtyMask.begin(), DirtyMask.end(), 0);
     bDirty = false;
 }
 
+void CResourceBindings::Reset()
+{
+    std::fill(Slots.begin(), Slots.end(), BindingInfo {});
+    std::fill(BoundMask.begin(), BoundMask.end(), 0);
+    BoundCount = 0;
+    ClearDirtyBits();
+}
+
+const BindingInfo* CResourceBindings::GetBinding(uint32_t binding, uint32_t arrayElement) const
+{
+    const auto* range = Layout.FindSlotRange(binding);
+    if (!range || arrayElement >= range->Count)
+        return nullptr;
+    uint32_t slot = range->FirstSlot + arrayElement;
+    if (!(BoundMask[slot / 64] & (1ull << (slot % 64))))
+        return nullptr;
+    return &Slots[slot];
+}
+
 void CResourceBindings::BindBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range,
-                                   uint32_t set, uint32_t binding, uint32_t arrayElement)
+                                   uint32_t binding, uint32_t arrayElement, bool bTransient)
+{
+    Bind(binding, arrayElement, BindingInfo { buffer, offset, range, bTransient });
+}
+
+void CResourceBindings::BindBuffer(CBufferVk* pBuffer, VkDeviceSize offset, VkDeviceSize range,
+                                   uint32_t binding, uint32_t arrayElement)
 {
-    Bind(set, binding, arrayElement, BindingInfo { buffer, offset, range });
+    BindingInfo info { pBuffer->GetHandle(), pBuffer->GetOffset() + offset, range, false };
+    info.Buffer = pBuffer;
+    Bind(binding, arrayElement, info);
 }
 
 void CResourceBindings::BindImageView(CImageViewVk* pImageView, VkAccessFlags access,
                                       VkPipelineStageFlags stages, VkImageLayout layout,
-                                      uint32_t set, uint32_t binding, uint32_t arrayElement)
+                                      uint32_t binding, uint32_t arrayElement)
 {
-    Bind(set, binding, arrayElement, BindingInfo { pImageView, access, stages, layout });
+    Bind(binding, arrayElement, BindingInfo { pImageView, access, stages, layout });
 }
 
-void CResourceBindings::BindSampler(VkSampler sampler, uint32_t set, uint32_t binding,
-                                    uint32_t arrayElement)
+void CResourceBindings::BindSampler(VkSampler sampler, uint32_t binding, uint32_t arrayElement)
 {
-    Bind(set, binding, arrayElement, BindingInfo { sampler });
+    Bind(binding, arrayElement, BindingInfo { sampler });
 }
 
-void CResourceBindings::Bind(uint32_t set, uint32_t binding, uint32_t arrayElement,
-                             const BindingInfo& info)
+void CResourceBindings::Unbind(uint32_t binding, uint32_t arrayElement)
 {
-    // If resource is being removed from binding, erase the entry.
-    if (info.BufferHandle == VK_NULL_HANDLE && info.ImageView == VK_NULL_HANDLE
-        && info.SamplerHandle == VK_NULL_HANDLE)
+    Bind(binding, arrayElement, BindingInfo {});
+}
+
+bool CResourceBindings::RefreshMoved(CDefragmenterVk& defragmenter)
+{
+    bool bMoved = false;
+    for (uint32_t slot = 0; slot < Slots.size(); slot++)
+    {
+        if (!(BoundMask[slot / 64] & (1ull << (slot % 64))))
+            continue;
+        auto& info = Slots[slot];
+        if (!info.Buffer)
+            continue;
+        VkBuffer handle = defragmenter.GetBufferHandle(info.Buffer, info.BufferHandle);
+        if (handle == info.BufferHandle)
+            continue;
+        info.BufferHandle = handle;
+        DirtyMask[slot / 64] |= 1ull << (slot % 64);
+        bDirty = true;
+        bMoved = true;
+    }
+    return bMoved;
+}
+
+uint32_t CResourceBindings::GetSlot(uint32_t binding, uint32_t arrayElement) const
+{
+    const auto* range = Layout.FindSlotRange(binding);
+    if (!range)
+        throw CRHIRuntimeError("Descriptor set layout has no such binding");
+    if (arrayElement >= range->Count)
+        throw CRHIRuntimeError("Descriptor array index out of range");
+    return range->FirstSlot + arrayElement;
+}
+
+void CResourceBindings::Bind(uint32_t binding, uint32_t arrayElement, const BindingInfo& info)
+{
+    uint32_t slot = GetSlot(binding, arrayElement);
+    uint64_t bit = 1ull << (slot % 64);
+    uint64_t& boundWord = BoundMask[slot / 64];
+
+    bool bIsUnbind = info.BufferHandle == VK_NULL_HANDLE && info.ImageView == nullptr
+        && info.SamplerHandle == VK_NULL_HANDLE;
+    if (bIsUnbind)
     {
-        auto it = BindingsBySet.find(set);
-        if (it != BindingsBySet.end())
-        {
-            auto& setBindings = it->second;
-            auto it2 = setBindings.Bindings.find(binding);
-            if (it2 != setBindings.Bindings.end())
-            {
-                auto& arrayBindings = it2->second;
-                auto it3 = arrayBindings.find(arrayElement);
-                if (it3 != arrayBindings.end())
-                {
-                    arrayBindings.erase(it3);
-
-                    if (arrayBindings.size() == 0)
-                        setBindings.Bindings.erase(it2);
-
-                    setBindings.bDirty = true;
-                }
-            }
-        }
+        if (!(boundWord & bit))
+            return;
+        boundWord &= ~bit;
+        BoundCount--;
     }
-    // Else binding is being added.
-    else
+    else if (!(boundWord & bit))
     {
-        // If set # does not exist yet, add it.
-        auto it = BindingsBySet.find(set);
-        if (it == BindingsBySet.end())
-        {
-            ArrayBindings arrayBinding = { { arrayElement, info } };
-
-            SetBindings setBindings;
-            setBindings.Bindings.emplace(binding, std::move(arrayBinding));
-            setBindings.bDirty = true;
-
-            BindingsBySet.emplace(set, std::move(setBindings));
-        }
-        // Else, find the binding #.
-        else
-        {
-            // If the binding # does not exist, create it and add the array element.
-            auto& setBinding = it->second;
-            auto it2 = setBinding.Bindings.find(binding);
-            if (it2 == setBinding.Bindings.end())
-            {
-                ArrayBindings arrayBinding = { { arrayElement, info } };
-                setBinding.Bindings.emplace(binding, std::move(arrayBinding));
-            }
-            else
-            {
-                it2->second[arrayElement] = info;
-                setBinding.bDirty = true;
-            }
-        }
+        boundWord |= bit;
+        BoundCount++;
     }
 
+    Slots[slot] = info;
+    DirtyMask[slot / 64] |= bit;
     // Always mark CResourceBindings as dirty for fast checking during descriptor set binding.
     bDirty = true;
 }
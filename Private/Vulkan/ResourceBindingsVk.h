@@ -1,13 +1,15 @@
 #pragma once
 #include "BufferVk.h"
+#include "DescriptorSetLayoutVk.h"
 #include "ImageViewVk.h"
 #include "VkCommon.h"
-#include <map>
-#include <unordered_map>
+#include <vector>
 
 namespace RHI
 {
 
+class CDefragmenterVk;
+
 // Modified from V-EZ
 // Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
 //
@@ -34,6 +36,11 @@ struct BindingInfo
     VkDeviceSize Offset;
     VkDeviceSize Range;
     VkBuffer BufferHandle = VK_NULL_HANDLE;
+    // Points into the constant ring, the contents are only good for the current frame
+    bool bIsTransient = false;
+    // Null for the constant ring. Only ever looked up in the defragmenter, which knows whether
+    //   it's still alive
+    const CBufferVk* Buffer = nullptr;
 
     CImageViewVk* ImageView = nullptr;
     VkAccessFlags ImageAccess;
@@ -44,8 +51,9 @@ struct BindingInfo
 
     BindingInfo() = default;
 
-    BindingInfo(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+    BindingInfo(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, bool bTransient)
         : BufferHandle(buffer)
+        , bIsTransient(bTransient)
         , Offset(offset)
         , Range(range)
     {
@@ -66,38 +74,73 @@ struct BindingInfo
     }
 };
 
-typedef std::map<uint32_t, BindingInfo> ArrayBindings;
-
-struct SetBindings
-{
-    std::unordered_map<uint32_t, ArrayBindings> Bindings;
-    bool bDirty;
-};
-
+// Everything bound to one descriptor set, flat in the layout's slot order so binding is O(1)
+//   and never allocates
 class CResourceBindings
 {
 public:
-    bool IsDirty() const { return bDirty; }
-
-    std::unordered_map<uint32_t, SetBindings>& GetSetBindings() { return BindingsBySet; }
+    // The layout must outlive this
+    explicit CResourceBindings(const CDescriptorSetLayoutVk& layout);
 
-    void ClearDirtyBit() { bDirty = false; }
+    bool IsDirty() const { return bDirty; }
+    // Forgets which slots changed
+    void ClearDirtyBits();
+    // Every descriptor in the layout has something bound
+    bool IsFullyBound() const { return BoundCount == Slots.size(); }
 
-    void Clear(uint32_t set);
+    // Returns nullptr if nothing is bound there
+    const BindingInfo* GetBinding(uint32_t binding, uint32_t arrayElement) const;
 
     void Reset();
 
-    void BindBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t set,
-                    uint32_t binding, uint32_t arrayElement);
+    void BindBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding,
+                    uint32_t arrayElement, bool bTransient = false);
+    // Offset is within the buffer, which may start partway into its VkBuffer
+    void BindBuffer(CBufferVk* pBuffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding,
+                    uint32_t arrayElement);
     void BindImageView(CImageViewVk* pImageView, VkAccessFlags access, VkPipelineStageFlags stages,
-                       VkImageLayout layout, uint32_t set, uint32_t binding, uint32_t arrayElement);
-    void BindSampler(VkSampler sampler, uint32_t set, uint32_t binding, uint32_t arrayElement);
+                       VkImageLayout layout, uint32_t binding, uint32_t arrayElement);
+    void BindSampler(VkSampler sampler, uint32_t binding, uint32_t arrayElement);
+    void Unbind(uint32_t binding, uint32_t arrayElement);
+    // Marks whatever the defragmenter has given a new handle as dirty, returns false if nothing
+    bool RefreshMoved(CDefragmenterVk& defragmenter);
 
-private:
-    void Bind(uint32_t set, uint32_t binding, uint32_t arrayElement, const BindingInfo& info);
+    // Calls fn(binding, arrayElement, slot, info) in binding order
+    template <typename TFunc> void ForEachBound(TFunc&& fn) const { ForEach(BoundMask, fn); }
+    // Same, but only for what was bound since the last ClearDirtyBits
+    template <typename TFunc> void ForEachDirty(TFunc&& fn) const { ForEach(DirtyMask, fn); }
 
-    std::unordered_map<uint32_t, SetBindings> BindingsBySet;
+private:
+    uint32_t GetSlot(uint32_t binding, uint32_t arrayElement) const;
+    void Bind(uint32_t binding, uint32_t arrayElement, const BindingInfo& info);
+    template <typename TFunc> void ForEach(const std::vector<uint64_t>& mask, TFunc& fn) const;
+
+    const CDescriptorSetLayoutVk& Layout;
+    std::vector<BindingInfo> Slots;
+    // One bit per slot
+    std::vector<uint64_t> BoundMask;
+    std::vector<uint64_t> DirtyMask;
+    size_t BoundCount = 0;
     bool bDirty = false;
 };
 
+template <typename TFunc>
+void CResourceBindings::ForEach(const std::vector<uint64_t>& mask, TFunc& fn) const
+{
+    const auto& ranges = Layout.GetSlotRanges();
+    size_t r = 0;
+    for (size_t word = 0; word < mask.size(); word++)
+    {
+        uint64_t bits = mask[word] & BoundMask[word];
+        for (uint32_t slot = static_cast<uint32_t>(word * 64); bits; slot++, bits >>= 1)
+        {
+            if (!(bits & 1))
+                continue;
+            while (slot >= ranges[r].FirstSlot + ranges[r].Count)
+                r++;
+            fn(ranges[r].Binding, slot - ranges[r].FirstSlot, slot, Slots[slot]);
+        }
+    }
+}
+
 } /* namespace RHI */
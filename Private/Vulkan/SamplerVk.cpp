@@ -33,6 +33,11 @@ CSamplerVk::CSamplerVk(CDeviceVk& p, const CSamplerDesc& desc)
 	vkCreateSampler(Parent.GetVkDevice(), &samplerInfo, nullptr, &Sampler);
 }
 
-CSamplerVk::~CSamplerVk() { vkDestroySampler(Parent.GetVkDevice(), Sampler, nullptr); }
+CSamplerVk::~CSamplerVk()
+{
+    if (auto* cache = Parent.GetDescriptorSetCache())
+        cache->Evict(GetHandleKey(Sampler));
+    vkDestroySampler(Parent.GetVkDevice(), Sampler, nullptr);
+}
 
 } /* namespace RHI */
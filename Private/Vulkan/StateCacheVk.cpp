@@ -0,0 +1,66 @@
+#include "StateCacheVk.h"
+#include "DescriptorSetLayoutVk.h"
+#include "DeviceVk.h"
+#include "SamplerVk.h"
+#include <algorithm>
+
+namespace RHI
+{
+
+CStateCacheVk::CStateCacheVk(CDeviceVk& p)
+    : Parent(p)
+{
+}
+
+CDescriptorSetLayout::Ref
+CStateCacheVk::FindOrCreate(const std::vector<CDescriptorSetLayoutBinding>& bindings,
+                            bool bPushDescriptors)
+{
+    CSetLayoutKey key { bindings, bPushDescriptors };
+    std::sort(key.Bindings.begin(), key.Bindings.end(),
+              [](const CDescriptorSetLayoutBinding& a, const CDescriptorSetLayoutBinding& b) {
+                  return a.Binding < b.Binding;
+              });
+
+    std::unique_lock<std::mutex> lk(SetLayoutMutex);
+    auto iter = SetLayoutCache.find(key);
+    if (iter != SetLayoutCache.end())
+        return iter->second;
+
+    auto layout = std::make_shared<CDescriptorSetLayoutVk>(Parent, bindings, bPushDescriptors);
+    SetLayoutCache.emplace(std::move(key), layout);
+    return layout;
+}
+
+CPipelineLayout::Ref
+CStateCacheVk::FindOrCreate(const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+                            const std::vector<CPushConstantRange>& pushConstantRanges)
+{
+    CPipelineLayoutKey key;
+    for (const auto& layout : setLayouts)
+        key.SetLayouts.push_back(layout.get());
+    key.PushConstantRanges = pushConstantRanges;
+
+    std::unique_lock<std::mutex> lk(PipelineLayoutMutex);
+    auto iter = PipelineLayoutCache.find(key);
+    if (iter != PipelineLayoutCache.end())
+        return iter->second;
+
+    auto layout = std::make_shared<CPipelineLayoutVk>(Parent, setLayouts, pushConstantRanges);
+    PipelineLayoutCache.emplace(std::move(key), layout);
+    return layout;
+}
+
+CSampler::Ref CStateCacheVk::FindOrCreate(const CSamplerDesc& desc)
+{
+    std::unique_lock<std::mutex> lk(SamplerMutex);
+    auto iter = SamplerCache.find(desc);
+    if (iter != SamplerCache.end())
+        return iter->second;
+
+    auto sampler = std::make_shared<CSamplerVk>(Parent, desc);
+    SamplerCache.emplace(desc, sampler);
+    return sampler;
+}
+
+} /* namespace RHI */
@@ -0,0 +1,81 @@
+#pragma once
+#include "DescriptorSet.h"
+#include "Sampler.h"
+#include "VkCommon.h"
+#include <Hash.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace RHI
+{
+
+// Hands out one shared object per distinct description. Layouts built from the same reflection
+//   stay compatible across pipelines, and their sets come from the same descriptor pool
+class CStateCacheVk
+{
+public:
+    explicit CStateCacheVk(CDeviceVk& p);
+
+    CDescriptorSetLayout::Ref FindOrCreate(const std::vector<CDescriptorSetLayoutBinding>& bindings,
+                                           bool bPushDescriptors);
+    CPipelineLayout::Ref FindOrCreate(const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+                                      const std::vector<CPushConstantRange>& pushConstantRanges);
+    CSampler::Ref FindOrCreate(const CSamplerDesc& desc);
+
+private:
+    struct CSetLayoutKey
+    {
+        // Sorted by binding, the order they were listed in doesn't matter
+        std::vector<CDescriptorSetLayoutBinding> Bindings;
+        bool bPushDescriptors;
+
+        bool operator==(const CSetLayoutKey& rhs) const
+        {
+            return Bindings == rhs.Bindings && bPushDescriptors == rhs.bPushDescriptors;
+        }
+
+        friend std::size_t hash_value(const CSetLayoutKey& r)
+        {
+            std::size_t result = 0;
+            for (const auto& b : r.Bindings)
+                tc::hash_combine(result, hash_value(b));
+            tc::hash_combine(result, r.bPushDescriptors);
+            return result;
+        }
+    };
+
+    struct CPipelineLayoutKey
+    {
+        // Set layouts come out of this cache too, so comparing pointers is enough
+        std::vector<CDescriptorSetLayout*> SetLayouts;
+        std::vector<CPushConstantRange> PushConstantRanges;
+
+        bool operator==(const CPipelineLayoutKey& rhs) const
+        {
+            return SetLayouts == rhs.SetLayouts && PushConstantRanges == rhs.PushConstantRanges;
+        }
+
+        friend std::size_t hash_value(const CPipelineLayoutKey& r)
+        {
+            std::size_t result = 0;
+            for (auto* layout : r.SetLayouts)
+                tc::hash_combine(result, reinterpret_cast<std::size_t>(layout));
+            for (const auto& range : r.PushConstantRanges)
+                tc::hash_combine(result, hash_value(range));
+            return result;
+        }
+    };
+
+    CDeviceVk& Parent;
+    std::mutex SetLayoutMutex;
+    std::unordered_map<CSetLayoutKey, CDescriptorSetLayout::Ref, tc::hash<CSetLayoutKey>>
+        SetLayoutCache;
+    std::mutex PipelineLayoutMutex;
+    std::unordered_map<CPipelineLayoutKey, CPipelineLayout::Ref, tc::hash<CPipelineLayoutKey>>
+        PipelineLayoutCache;
+    std::mutex SamplerMutex;
+    std::unordered_map<CSamplerDesc, CSampler::Ref, tc::hash<CSamplerDesc>> SamplerCache;
+};
+
+} /* namespace RHI */
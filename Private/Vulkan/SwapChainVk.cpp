@@ -250,7 +250,11 @@ void CSwapChainVk::Present(const CSwapChainPresentInfo& info)
     presentInfo.pSwapchains = &SwapChainHandle;
     presentInfo.pImageIndices = &imageInfo.first;
     presentInfo.pResults = nullptr;
-    vkQueuePresentKHR(Parent.GetVkQueue(EQueueType::Render), &presentInfo);
+    {
+        VkQueue presentQueue = Parent.GetDefaultRenderQueue()->GetHandle();
+        std::lock_guard<std::mutex> lk(Parent.GetVkQueueMutex(presentQueue));
+        vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
 
     // Waiter cleans up the semaphore
     Parent.AddPostFrameCleanup([waitSemaphore](CDeviceVk& p) {
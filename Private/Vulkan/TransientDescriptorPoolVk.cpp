@@ -0,0 +1,215 @@
+#include "TransientDescriptorPoolVk.h"
+#include "DescriptorSetLayoutVk.h"
+#include "DeviceVk.h"
+#include <algorithm>
+
+namespace RHI
+{
+
+namespace
+{
+
+std::atomic<uint64_t> NextInstanceId { 1 };
+
+struct CThreadPoolsCache
+{
+    uint64_t InstanceId = 0;
+    uint64_t Frame = 0;
+    void* Pools = nullptr;
+};
+
+thread_local CThreadPoolsCache ThreadPoolsCache;
+
+}
+
+CTransientDescriptorPoolVk::CTransientDescriptorPoolVk(CDeviceVk& p)
+    : Parent(p)
+    , InstanceId(NextInstanceId++)
+{
+}
+
+CTransientDescriptorPoolVk::~CTransientDescriptorPoolVk()
+{
+    for (auto& slot : FrameSlots)
+        for (auto& pair : slot.Threads)
+            DestroyPools(*pair.second);
+}
+
+VkDescriptorSet CTransientDescriptorPoolVk::Allocate(const CDescriptorSetLayoutVk& layout)
+{
+    auto& threadPools = GetThreadPools();
+
+    auto& batch = threadPools.Batches[layout.GetHandle()];
+    if (batch.empty())
+    {
+        CDescriptorCounts setDescriptors {};
+        for (const auto& binding : layout.GetBindings())
+        {
+            if (binding.descriptorType >= DescriptorTypeCount)
+                throw CRHIRuntimeError("Unsupported descriptor type for transient descriptor sets");
+            setDescriptors[binding.descriptorType] += binding.descriptorCount;
+        }
+
+        CDescriptorCounts batchDescriptors;
+        for (uint32_t t = 0; t < DescriptorTypeCount; t++)
+            batchDescriptors[t] = setDescriptors[t] * BatchSize;
+
+        auto fits = [&](const CPool& pool) {
+            if (pool.SetsLeft < BatchSize)
+                return false;
+            for (uint32_t t = 0; t < DescriptorTypeCount; t++)
+                if (pool.DescriptorsLeft[t] < batchDescriptors[t])
+                    return false;
+            return true;
+        };
+
+        while (threadPools.CurrPool < threadPools.Pools.size()
+               && !fits(threadPools.Pools[threadPools.CurrPool]))
+            threadPools.CurrPool++;
+
+        if (threadPools.CurrPool == threadPools.Pools.size())
+        {
+            // Out of room mid frame, grow geometrically so this doesn't happen again
+            uint32_t maxSets = MinSetsPerPool;
+            CDescriptorCounts maxDescriptors;
+            maxDescriptors.fill(MinDescriptorsPerPool);
+            if (!threadPools.Pools.empty())
+            {
+                const auto& last = threadPools.Pools.back();
+                maxSets = last.MaxSets * 2;
+                for (uint32_t t = 0; t < DescriptorTypeCount; t++)
+                    maxDescriptors[t] = last.MaxDescriptors[t] * 2;
+            }
+            maxSets = std::max(maxSets, BatchSize);
+            for (uint32_t t = 0; t < DescriptorTypeCount; t++)
+                maxDescriptors[t] = std::max(maxDescriptors[t], batchDescriptors[t]);
+            threadPools.Pools.push_back(CreatePool(maxSets, maxDescriptors));
+        }
+
+        auto& pool = threadPools.Pools[threadPools.CurrPool];
+        std::array<VkDescriptorSetLayout, BatchSize> layouts;
+        layouts.fill(layout.GetHandle());
+        batch.resize(BatchSize);
+
+        VkDescriptorSetAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+        allocInfo.descriptorPool = pool.Handle;
+        allocInfo.descriptorSetCount = BatchSize;
+        allocInfo.pSetLayouts = layouts.data();
+        VK(vkAllocateDescriptorSets(Parent.GetVkDevice(), &allocInfo, batch.data()));
+
+        pool.SetsLeft -= BatchSize;
+        threadPools.SetDemand += BatchSize;
+        for (uint32_t t = 0; t < DescriptorTypeCount; t++)
+        {
+            pool.DescriptorsLeft[t] -= batchDescriptors[t];
+            threadPools.DescriptorDemand[t] += batchDescriptors[t];
+        }
+    }
+
+    VkDescriptorSet handle = batch.back();
+    batch.pop_back();
+    return handle;
+}
+
+uint64_t CTransientDescriptorPoolVk::NextFrame() { return CurrFrame++; }
+
+void CTransientDescriptorPoolVk::ResetFrame(uint64_t frame)
+{
+    auto& slot = FrameSlots[frame % FrameSlotCount];
+    std::lock_guard<std::mutex> lk(slot.Mutex);
+
+    for (auto iter = slot.Threads.begin(); iter != slot.Threads.end();)
+    {
+        auto& threadPools = *iter->second;
+        if (slot.Frame != frame || threadPools.SetDemand == 0)
+        {
+            // The thread allocated nothing this frame and may have exited, so don't keep its pools.
+            //   Its thread local cache names an older frame and can't lead back to the entry
+            DestroyPools(threadPools);
+            iter = slot.Threads.erase(iter);
+            continue;
+        }
+        threadPools.Batches.clear();
+
+        if (threadPools.Pools.size() > 1)
+        {
+            // Replace the chain with one pool that fits what the frame actually used
+            DestroyPools(threadPools);
+            // Plus a quarter of headroom
+            auto withHeadroom = [](uint32_t demand, uint32_t minimum) {
+                return std::max(demand + demand / 4, minimum);
+            };
+            CDescriptorCounts maxDescriptors;
+            for (uint32_t t = 0; t < DescriptorTypeCount; t++)
+                maxDescriptors[t] =
+                    withHeadroom(threadPools.DescriptorDemand[t], MinDescriptorsPerPool);
+            uint32_t maxSets = withHeadroom(threadPools.SetDemand, MinSetsPerPool);
+            threadPools.Pools.push_back(CreatePool(maxSets, maxDescriptors));
+        }
+        else
+        {
+            for (auto& pool : threadPools.Pools)
+            {
+                vkResetDescriptorPool(Parent.GetVkDevice(), pool.Handle, 0);
+                pool.SetsLeft = pool.MaxSets;
+                pool.DescriptorsLeft = pool.MaxDescriptors;
+            }
+        }
+
+        threadPools.CurrPool = 0;
+        threadPools.SetDemand = 0;
+        threadPools.DescriptorDemand.fill(0);
+        ++iter;
+    }
+}
+
+CTransientDescriptorPoolVk::CThreadPools& CTransientDescriptorPoolVk::GetThreadPools()
+{
+    uint64_t frame = CurrFrame;
+    if (ThreadPoolsCache.InstanceId == InstanceId && ThreadPoolsCache.Frame == frame)
+        return *static_cast<CThreadPools*>(ThreadPoolsCache.Pools);
+
+    auto& slot = FrameSlots[frame % FrameSlotCount];
+    std::lock_guard<std::mutex> lk(slot.Mutex);
+    slot.Frame = frame;
+    auto& threadPools = slot.Threads[std::this_thread::get_id()];
+    if (!threadPools)
+        threadPools = std::make_unique<CThreadPools>();
+
+    ThreadPoolsCache.InstanceId = InstanceId;
+    ThreadPoolsCache.Frame = frame;
+    ThreadPoolsCache.Pools = threadPools.get();
+    return *threadPools;
+}
+
+CTransientDescriptorPoolVk::CPool
+CTransientDescriptorPoolVk::CreatePool(uint32_t maxSets, const CDescriptorCounts& maxDescriptors)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (uint32_t t = 0; t < DescriptorTypeCount; t++)
+        if (maxDescriptors[t] > 0)
+            poolSizes.push_back({ static_cast<VkDescriptorType>(t), maxDescriptors[t] });
+
+    // No FREE_DESCRIPTOR_SET_BIT, sets are only ever released by resetting the whole pool
+    VkDescriptorPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    createInfo.maxSets = maxSets;
+    createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    createInfo.pPoolSizes = poolSizes.data();
+
+    CPool pool;
+    VK(vkCreateDescriptorPool(Parent.GetVkDevice(), &createInfo, nullptr, &pool.Handle));
+    pool.MaxSets = maxSets;
+    pool.MaxDescriptors = maxDescriptors;
+    pool.SetsLeft = maxSets;
+    pool.DescriptorsLeft = maxDescriptors;
+    return pool;
+}
+
+void CTransientDescriptorPoolVk::DestroyPools(CThreadPools& threadPools)
+{
+    for (auto& pool : threadPools.Pools)
+        vkDestroyDescriptorPool(Parent.GetVkDevice(), pool.Handle, nullptr);
+    threadPools.Pools.clear();
+}
+
+}
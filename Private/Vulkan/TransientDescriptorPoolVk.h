@@ -0,0 +1,85 @@
+#pragma once
+#include "VkCommon.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace RHI
+{
+
+class CDescriptorSetLayoutVk;
+
+// Hands out descriptor sets that only live until the frame retires. Every recording thread gets
+//   its own pools for each frame, so allocation is lock free, and the pools are reset wholesale
+//   instead of freeing sets one by one. A thread that allocates nothing in a frame loses its
+//   pools for that slot, so threads that exit don't leave pools behind
+class CTransientDescriptorPoolVk
+{
+public:
+    explicit CTransientDescriptorPoolVk(CDeviceVk& p);
+    ~CTransientDescriptorPoolVk();
+
+    VkDescriptorSet Allocate(const CDescriptorSetLayoutVk& layout);
+
+    // Sets allocated in an earlier frame are gone once that frame retires
+    uint64_t GetCurrentFrame() const { return CurrFrame; }
+    // Starts a new frame and returns the one that just ended
+    uint64_t NextFrame();
+    // Called once the GPU is done with the frame, also drops the pools of threads idle in it
+    void ResetFrame(uint64_t frame);
+
+private:
+    // Core descriptor types are 0 to VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT
+    static constexpr uint32_t DescriptorTypeCount = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1;
+    typedef std::array<uint32_t, DescriptorTypeCount> CDescriptorCounts;
+
+    // Sets grabbed from a pool per vkAllocateDescriptorSets
+    static constexpr uint32_t BatchSize = 8;
+    static constexpr uint32_t MinSetsPerPool = 256;
+    static constexpr uint32_t MinDescriptorsPerPool = 256;
+    // One more than the frames in flight so the slot being reset is never the one being recorded
+    static constexpr uint32_t FrameSlotCount = 4;
+
+    struct CPool
+    {
+        VkDescriptorPool Handle = VK_NULL_HANDLE;
+        uint32_t MaxSets = 0;
+        CDescriptorCounts MaxDescriptors {};
+        uint32_t SetsLeft = 0;
+        CDescriptorCounts DescriptorsLeft {};
+    };
+
+    struct CThreadPools
+    {
+        std::vector<CPool> Pools;
+        size_t CurrPool = 0;
+        // Leftovers from the last batch of each layout
+        std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> Batches;
+        // What this thread used in the frame, the pools are resized to fit on reset
+        uint32_t SetDemand = 0;
+        CDescriptorCounts DescriptorDemand {};
+    };
+
+    struct CFrameSlot
+    {
+        uint64_t Frame = 0;
+        std::mutex Mutex;
+        std::unordered_map<std::thread::id, std::unique_ptr<CThreadPools>> Threads;
+    };
+
+    CThreadPools& GetThreadPools();
+    CPool CreatePool(uint32_t maxSets, const CDescriptorCounts& maxDescriptors);
+    void DestroyPools(CThreadPools& threadPools);
+
+    CDeviceVk& Parent;
+    // Tells the thread local lookup apart from other instances
+    uint64_t InstanceId;
+    std::atomic<uint64_t> CurrFrame { 0 };
+    std::array<CFrameSlot, FrameSlotCount> FrameSlots;
+};
+
+}
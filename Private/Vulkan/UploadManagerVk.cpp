@@ -0,0 +1,240 @@
+#include "UploadManagerVk.h"
+#include "CommandContextVk.h"
+#include "CommandListVk.h"
+#include "CommandQueueVk.h"
+#include "DeviceVk.h"
+#include <algorithm>
+#include <cstring>
+
+namespace RHI
+{
+
+CUploadManagerVk::CUploadManagerVk(CDeviceVk& p)
+    : Parent(p)
+{
+    VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bufferInfo.size = StagingSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo stagingInfo;
+    VK(vmaCreateBuffer(Parent.GetAllocator(), &bufferInfo, &allocInfo, &Staging,
+                       &StagingAllocation, &stagingInfo));
+    MappedData = static_cast<char*>(stagingInfo.pMappedData);
+    Parent.CountAllocation(EMemoryCategory::Staging, StagingAllocation);
+}
+
+CUploadManagerVk::~CUploadManagerVk()
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    SubmitBatch();
+    RetireBatches(NextToken);
+    for (VkFence fence : FreeFences)
+        vkDestroyFence(Parent.GetVkDevice(), fence, nullptr);
+    Parent.CountFree(EMemoryCategory::Staging, StagingAllocation);
+    vmaDestroyBuffer(Parent.GetAllocator(), Staging, StagingAllocation);
+}
+
+uint64_t CUploadManagerVk::Upload(const void* data, size_t size, size_t alignment,
+                                  const CRecordFn& record, std::shared_ptr<void> keepAlive)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    RetireBatches();
+
+    bool bDedicated = size > StagingSize;
+    uint64_t begin = 0;
+    if (size > 0 && !bDedicated)
+    {
+        while (!ReserveStaging(size, alignment, begin))
+        {
+            // The ring is full, push out what we have and wait for the oldest batch to free some
+            SubmitBatch();
+            assert(!InFlight.empty());
+            RetireBatches(InFlight.front().Token);
+        }
+    }
+
+    if (!Curr.List)
+        BeginBatch();
+
+    VkBuffer staging = Staging;
+    size_t offset = 0;
+    if (bDedicated)
+    {
+        VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        VmaAllocation allocation;
+        VmaAllocationInfo stagingInfo;
+        VK(vmaCreateBuffer(Parent.GetAllocator(), &bufferInfo, &allocInfo, &staging, &allocation,
+                           &stagingInfo));
+        Parent.CountAllocation(EMemoryCategory::Staging, allocation);
+        memcpy(stagingInfo.pMappedData, data, size);
+        vmaFlushAllocation(Parent.GetAllocator(), allocation, 0, size);
+        Curr.DedicatedStaging.emplace_back(staging, allocation);
+    }
+    else if (size > 0)
+    {
+        offset = static_cast<size_t>(begin % StagingSize);
+        memcpy(MappedData + offset, data, size);
+        vmaFlushAllocation(Parent.GetAllocator(), StagingAllocation, offset, size);
+        Curr.StagingEnd = Head;
+    }
+
+    record(*Context, staging, offset);
+    if (keepAlive)
+        KeepAlive.push_back(std::move(keepAlive));
+    Curr.Bytes += size;
+    CurrUploads++;
+    Stats.Uploads++;
+
+    uint64_t token = Curr.Token;
+    if (Curr.Bytes >= BatchByteLimit || CurrUploads >= BatchUploadLimit)
+        SubmitBatch();
+    return token;
+}
+
+uint64_t CUploadManagerVk::Flush()
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    RetireBatches();
+    return SubmitBatch();
+}
+
+bool CUploadManagerVk::IsComplete(uint64_t token)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    RetireBatches();
+    return token <= CompletedToken;
+}
+
+void CUploadManagerVk::Wait(uint64_t token)
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    if (Curr.List && token >= Curr.Token)
+        SubmitBatch();
+    RetireBatches(token);
+}
+
+CUploadStats CUploadManagerVk::GetStats() const
+{
+    std::lock_guard<std::mutex> lk(Mutex);
+    return Stats;
+}
+
+void CUploadManagerVk::BeginBatch()
+{
+    Curr = CBatch {};
+    Curr.List = std::static_pointer_cast<CCommandListVk>(
+        Parent.GetDefaultCopyQueue()->CreateCommandList());
+    Context = std::static_pointer_cast<CCommandContextVk>(Curr.List->CreateCopyContext());
+    Curr.Token = NextToken++;
+    Curr.StagingEnd = Head;
+    CurrUploads = 0;
+}
+
+uint64_t CUploadManagerVk::SubmitBatch()
+{
+    if (!Curr.List)
+        return 0;
+
+    // Buffers aren't tracked, make every copy visible to whatever the queue runs next
+    VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(Context->GetCmdBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                         nullptr);
+    Context->FinishRecording();
+    Context.reset();
+
+    Curr.Fence = AcquireFence();
+    Curr.SubmitTime = std::chrono::steady_clock::now();
+    Parent.GetDefaultCopyQueue()->SubmitImmediately(*Curr.List, Curr.Fence);
+    KeepAlive.clear();
+
+    uint64_t token = Curr.Token;
+    InFlight.push(std::move(Curr));
+    Curr = CBatch {};
+    return token;
+}
+
+void CUploadManagerVk::RetireBatches(uint64_t waitToken)
+{
+    while (!InFlight.empty())
+    {
+        auto& batch = InFlight.front();
+        if (batch.Token <= waitToken)
+            VK(vkWaitForFences(Parent.GetVkDevice(), 1, &batch.Fence, VK_TRUE, UINT64_MAX));
+        else if (vkGetFenceStatus(Parent.GetVkDevice(), batch.Fence) != VK_SUCCESS)
+            break;
+
+        // Batches complete in order, only count the time the previous one didn't cover already
+        auto now = std::chrono::steady_clock::now();
+        auto busyBegin = std::max(batch.SubmitTime, LastCompleteTime);
+        BusySeconds += std::chrono::duration<double>(now - busyBegin).count();
+        LastCompleteTime = now;
+        Stats.Batches++;
+        Stats.Bytes += batch.Bytes;
+        if (BusySeconds > 0.0)
+            Stats.MegabytesPerSecond = Stats.Bytes / (1024.0 * 1024.0) / BusySeconds;
+
+        // A batch without staged data may end before an earlier reset of the ring
+        Tail = std::max(Tail, batch.StagingEnd);
+        for (const auto& pair : batch.DedicatedStaging)
+        {
+            Parent.CountFree(EMemoryCategory::Staging, pair.second);
+            vmaDestroyBuffer(Parent.GetAllocator(), pair.first, pair.second);
+        }
+        batch.List->ReleaseAllResources();
+        VK(vkResetFences(Parent.GetVkDevice(), 1, &batch.Fence));
+        FreeFences.push_back(batch.Fence);
+        CompletedToken = batch.Token;
+        InFlight.pop();
+    }
+}
+
+bool CUploadManagerVk::ReserveStaging(size_t size, size_t alignment, uint64_t& outBegin)
+{
+    // Nothing in use, start over at the beginning so the whole ring is available
+    if (Head == Tail)
+        Head = Tail = (Head + StagingSize - 1) / StagingSize * StagingSize;
+
+    size_t offset = static_cast<size_t>(Head % StagingSize);
+    size_t alignedOffset = (offset + alignment - 1) / alignment * alignment;
+    uint64_t begin = Head + (alignedOffset - offset);
+    // Don't straddle the end of the ring, skip to the start instead
+    if (alignedOffset + size > StagingSize)
+        begin = Head + (StagingSize - offset);
+    uint64_t end = begin + size;
+    if (end - Tail > StagingSize)
+        return false;
+    Head = end;
+    outBegin = begin;
+    return true;
+}
+
+VkFence CUploadManagerVk::AcquireFence()
+{
+    if (!FreeFences.empty())
+    {
+        VkFence fence = FreeFences.back();
+        FreeFences.pop_back();
+        return fence;
+    }
+
+    VkFence fence;
+    VkFenceCreateInfo fenceInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+    VK(vkCreateFence(Parent.GetVkDevice(), &fenceInfo, nullptr, &fence));
+    return fence;
+}
+
+}
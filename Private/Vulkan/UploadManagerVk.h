@@ -0,0 +1,98 @@
+#pragma once
+#include "Resources.h"
+#include "VkCommon.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace RHI
+{
+
+class CCommandListVk;
+
+// Uploads initial data through a persistently mapped staging ring. Everything is recorded into one
+//   command list that is submitted when it gets big enough, when somebody waits on it, or right
+//   before the copy queue submits anything else, so resources are ready for whatever follows.
+//   Tokens number the batches and complete in order
+class CUploadManagerVk
+{
+public:
+    // Records the commands that read the staged data at `offset` in `staging`
+    typedef std::function<void(CCommandContextVk& ctx, VkBuffer staging, size_t offset)>
+        CRecordFn;
+
+    explicit CUploadManagerVk(CDeviceVk& p);
+    ~CUploadManagerVk();
+    CUploadManagerVk(const CUploadManagerVk&) = delete;
+    CUploadManagerVk& operator=(const CUploadManagerVk&) = delete;
+
+    // Safe to call from any thread. `keepAlive` is held until the batch is submitted, for
+    //   resources the access tracker still points at. Returns the token of the batch
+    uint64_t Upload(const void* data, size_t size, size_t alignment, const CRecordFn& record,
+                    std::shared_ptr<void> keepAlive = nullptr);
+
+    // Submits what has been recorded so far and returns its token, 0 if nothing was pending
+    uint64_t Flush();
+    bool IsComplete(uint64_t token);
+    void Wait(uint64_t token);
+
+    CUploadStats GetStats() const;
+
+private:
+    static constexpr size_t StagingSize = 32 * 1024 * 1024;
+    // A batch is submitted once it holds this much
+    static constexpr size_t BatchByteLimit = 8 * 1024 * 1024;
+    static constexpr size_t BatchUploadLimit = 1024;
+
+    struct CBatch
+    {
+        uint64_t Token = 0;
+        std::shared_ptr<CCommandListVk> List;
+        VkFence Fence = VK_NULL_HANDLE;
+        // The staging ring is free up to here once the batch completes
+        uint64_t StagingEnd = 0;
+        size_t Bytes = 0;
+        // For uploads larger than the whole ring
+        std::vector<std::pair<VkBuffer, VmaAllocation>> DedicatedStaging;
+        std::chrono::steady_clock::time_point SubmitTime;
+    };
+
+    // All of these need Mutex held
+    void BeginBatch();
+    uint64_t SubmitBatch();
+    // Retires completed batches, waiting for the oldest ones up to `waitToken`
+    void RetireBatches(uint64_t waitToken = 0);
+    bool ReserveStaging(size_t size, size_t alignment, uint64_t& outBegin);
+    VkFence AcquireFence();
+
+    CDeviceVk& Parent;
+
+    VkBuffer Staging = VK_NULL_HANDLE;
+    VmaAllocation StagingAllocation = VK_NULL_HANDLE;
+    char* MappedData = nullptr;
+
+    mutable std::mutex Mutex;
+    // Positions only ever grow, the offset into the ring is the position modulo StagingSize
+    uint64_t Head = 0;
+    uint64_t Tail = 0;
+
+    // The batch being recorded, it has no list while there's nothing to record
+    CBatch Curr;
+    std::shared_ptr<CCommandContextVk> Context;
+    size_t CurrUploads = 0;
+    std::vector<std::shared_ptr<void>> KeepAlive;
+
+    std::queue<CBatch> InFlight;
+    std::vector<VkFence> FreeFences;
+    uint64_t NextToken = 1;
+    uint64_t CompletedToken = 0;
+
+    CUploadStats Stats;
+    double BusySeconds = 0.0;
+    std::chrono::steady_clock::time_point LastCompleteTime;
+};
+
+}
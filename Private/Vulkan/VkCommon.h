@@ -22,6 +22,7 @@
 namespace RHI
 {
 
+class CBufferVk;
 class CDeviceVk;
 class CCommandQueueVk;
 class CCommandContextVk;
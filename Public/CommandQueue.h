@@ -17,6 +17,18 @@ enum class EQueueType : uint32_t
     Count
 };
 
+// What the hardware backing a queue type can do
+struct CQueueCaps
+{
+    // How many hardware queues CreateCommandQueue(type) rotates through
+    uint32_t HardwareQueueCount = 0;
+    // False if this type shares the hardware with the render queue and won't run concurrently
+    bool bIsDedicated = false;
+    bool bSupportsRender = false;
+    bool bSupportsCompute = false;
+    bool bSupportsCopy = false;
+};
+
 class CCommandList : public std::enable_shared_from_this<CCommandList>
 {
 public:
@@ -27,6 +39,13 @@ public:
     virtual void Enqueue() = 0;
     virtual void Commit() = 0;
 
+    // Don't start executing this list until `other` on another queue has completed. Must be
+    //   called before `other` is committed. This list won't be submitted by its queue
+    //   until `other` has been submitted by its own queue, so flush the producer queue first.
+    //   Throws if the lists would end up waiting for each other through the queue order, and
+    //   SubmitFrame throws if the producer can't be submitted within the frame
+    virtual void WaitFor(CCommandList::Ref other) = 0;
+
     virtual ICopyContext::Ref CreateCopyContext() = 0;
     virtual IComputeContext::Ref CreateComputeContext() = 0;
     virtual IParallelRenderContext::Ref CreateParallelRenderContext(CRenderPass::Ref renderPass,
@@ -41,6 +60,7 @@ public:
     virtual ~CCommandQueue() = default;
 
     virtual CCommandList::Ref CreateCommandList() = 0;
+    virtual CRenderBundle::Ref CreateRenderBundle(CRenderPass::Ref renderPass, uint32_t subpass) = 0;
 
     virtual void Flush() = 0;
     virtual void Finish() = 0;
@@ -15,6 +15,8 @@ public:
 
     virtual void BindComputePipeline(CPipeline& pipeline) = 0;
     virtual void BindComputeDescriptorSet(uint32_t set, CDescriptorSet& descriptorSet) = 0;
+    // Writes into the push constant block of the bound pipeline's layout
+    virtual void PushConstants(uint32_t offset, uint32_t size, const void* data) = 0;
     virtual void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) = 0;
     virtual void DispatchIndirect(CBuffer& buffer, size_t offset) = 0;
 
@@ -89,6 +89,25 @@ struct CClearValue
     }
 };
 
+// Results of a GPU to CPU copy. Becomes ready once the command list holding the copy has been
+//   committed, submitted by its queue, and executed
+class CReadback
+{
+public:
+    typedef std::shared_ptr<CReadback> Ref;
+
+    virtual ~CReadback() = default;
+
+    // Never blocks
+    virtual bool IsReady() = 0;
+    // Blocks until the copy is done, but not for anything submitted after it. Throws if the
+    //   command list hasn't been submitted yet
+    virtual void Wait() = 0;
+    // Null until ready, then valid for as long as the handle lives
+    virtual const void* GetData() = 0;
+    virtual size_t GetSize() const = 0;
+};
+
 class ICopyContext
 {
 public:
@@ -111,6 +130,12 @@ public:
     virtual void ResolveImage(CImage& src, CImage& dst,
                               const std::vector<CImageResolve>& regions) = 0;
 
+    // Copy into memory from a pool of Readback buffers, poll the handle instead of finishing the
+    //   queue. Buffers aren't tracked, so the copy waits for all earlier writes to the source
+    virtual CReadback::Ref ReadbackBuffer(CBuffer& src, size_t offset, size_t size) = 0;
+    // BufferOffset is ignored, the data starts at the beginning of the readback
+    virtual CReadback::Ref ReadbackImage(CImage& src, const CBufferImageCopy& region) = 0;
+
     virtual void FinishRecording() = 0;
 };
 
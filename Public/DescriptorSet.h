@@ -1,6 +1,7 @@
 #pragma once
 #include "RHIChooseImpl.h"
 #include "ShaderModule.h"
+#include <Hash.h>
 #include <memory>
 
 namespace RHI
@@ -24,8 +25,47 @@ struct CDescriptorSetLayoutBinding
 {
     uint32_t Binding;
     EDescriptorType Type;
+    // 0 means an unbounded, partially bound array that can be updated after binding
     uint32_t Count;
     EShaderStageFlags StageFlags;
+
+    bool operator==(const CDescriptorSetLayoutBinding& rhs) const
+    {
+        return Binding == rhs.Binding && Type == rhs.Type && Count == rhs.Count
+            && StageFlags == rhs.StageFlags;
+    }
+
+    friend std::size_t hash_value(const CDescriptorSetLayoutBinding& r)
+    {
+        std::size_t result = 0;
+        tc::hash_combine(result, r.Binding);
+        tc::hash_combine(result, static_cast<std::underlying_type_t<EDescriptorType>>(r.Type));
+        tc::hash_combine(result, r.Count);
+        tc::hash_combine(result,
+                         static_cast<std::underlying_type_t<EShaderStageFlags>>(r.StageFlags));
+        return result;
+    }
+};
+
+// Running totals since the device was created
+struct CDescriptorStats
+{
+    // Sets recorded straight into the command buffer with push descriptors
+    uint64_t PushedSets = 0;
+    uint64_t PushedDescriptors = 0;
+    // Sets allocated from a pool and bound by handle
+    uint64_t BoundSets = 0;
+};
+
+// Memory behind BindConstants
+struct CConstantMemoryStats
+{
+    // Everything currently allocated for constants, in use or not
+    size_t Capacity = 0;
+    // Bytes handed out by the most recently finished frame
+    size_t LastFrameUsage = 0;
+    // Highest per frame usage since the device was created
+    size_t PeakFrameUsage = 0;
 };
 
 class CDescriptorSet
@@ -54,6 +94,58 @@ public:
     virtual CDescriptorSet::Ref CreateDescriptorSet() = 0;
 };
 
+// The device wide bindless resource heap. Shaders declare unbounded arrays in the heap's set:
+//   binding 0 for sampled images, 1 for storage buffers and 2 for samplers
+class CBindlessHeap
+{
+public:
+    typedef std::shared_ptr<CBindlessHeap> Ref;
+
+    static const uint32_t ImageBinding = 0;
+    static const uint32_t StorageBufferBinding = 1;
+    static const uint32_t SamplerBinding = 2;
+
+    virtual ~CBindlessHeap() = default;
+
+    virtual CDescriptorSetLayout::Ref GetLayout() const = 0;
+    // Bind it like any other descriptor set, registering more resources doesn't require a rebind
+    virtual CDescriptorSet::Ref GetDescriptorSet() const = 0;
+
+    // Returns an index that stays valid until unregistered. Safe to call from any thread, even
+    //   while contexts are binding the heap's descriptor set. An image is transitioned for
+    //   sampling once, by the first list that uses the heap after it is registered
+    virtual uint32_t RegisterImageView(CImageView::Ref imageView) = 0;
+    virtual uint32_t RegisterStorageBuffer(CBuffer::Ref buffer, size_t offset, size_t range) = 0;
+    virtual uint32_t RegisterSampler(CSampler::Ref sampler) = 0;
+    // The index is recycled once the GPU can no longer be using it
+    virtual void UnregisterImageView(uint32_t index) = 0;
+    virtual void UnregisterStorageBuffer(uint32_t index) = 0;
+    virtual void UnregisterSampler(uint32_t index) = 0;
+};
+
+// A block of push constants visible to the given stages, offsets and sizes are in bytes
+struct CPushConstantRange
+{
+    EShaderStageFlags StageFlags;
+    uint32_t Offset;
+    uint32_t Size;
+
+    bool operator==(const CPushConstantRange& rhs) const
+    {
+        return StageFlags == rhs.StageFlags && Offset == rhs.Offset && Size == rhs.Size;
+    }
+
+    friend std::size_t hash_value(const CPushConstantRange& r)
+    {
+        std::size_t result = 0;
+        tc::hash_combine(result,
+                         static_cast<std::underlying_type_t<EShaderStageFlags>>(r.StageFlags));
+        tc::hash_combine(result, r.Offset);
+        tc::hash_combine(result, r.Size);
+        return result;
+    }
+};
+
 class CPipelineLayout
 {
 public:
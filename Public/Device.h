@@ -24,6 +24,18 @@ enum class EDeviceCreateHints
     Discrete,
 };
 
+struct CDeviceCreateOptions
+{
+    // Memory kept around for BindConstants. It grows when a frame needs more and shrinks back
+    //   once the peak has passed, but never below this
+    size_t InitialConstantMemory = 8 * 1024 * 1024;
+    // Same for AllocateTransient
+    size_t InitialTransientMemory = 4 * 1024 * 1024;
+    // Lets Defragment move GPU only buffers. Images are never moved, Vulkan doesn't promise an
+    //   optimal tiling image recreated over moved memory reads back the same
+    bool bEnableDefragmentation = false;
+};
+
 template <typename TDerived> class RHI_API CDeviceBase : public tc::FNonCopyable
 {
 public:
@@ -34,6 +46,10 @@ public:
     // Resources and resource views
     CBuffer::Ref CreateBuffer(size_t size, EBufferUsageFlags usage,
                               const void* initialData = nullptr);
+    // Vertex, index, indirect or storage data the CPU writes once and the GPU reads in the same
+    //   frame. Already mapped and flushed at the end of the frame, the memory is recycled once
+    //   the frame retires. Bind Buffer with Offset, don't hold on to it
+    CTransientAllocation AllocateTransient(size_t size, EBufferUsageFlags usage);
     CImage::Ref CreateImage1D(EFormat format, EImageUsageFlags usage, uint32_t width,
                               uint32_t mipLevels = 1, uint32_t arrayLayers = 1,
                               uint32_t sampleCount = 1, const void* initialData = nullptr);
@@ -44,14 +60,29 @@ public:
                               uint32_t height, uint32_t depth, uint32_t mipLevels = 1,
                               uint32_t arrayLayers = 1, uint32_t sampleCount = 1,
                               const void* initialData = nullptr);
+    // Loads a KTX2 or DDS file with all of its mips and layers. Files with a single mip get the
+    //   rest generated if usage asks for GenMIPMaps, cube maps add CubeMap on their own
+    CImage::Ref CreateImageFromFile(const std::string& path, EImageUsageFlags usage);
     CImageView::Ref CreateImageView(const CImageViewDesc& desc, CImage::Ref image);
+    // Initial data is uploaded in batches. Submits everything queued so far and returns a token
+    //   to wait on, 0 if there was nothing to submit
+    uint64_t FlushUploads();
+    bool IsUploadComplete(uint64_t token);
+    void WaitForUpload(uint64_t token);
+    CUploadStats GetUploadStats() const;
 
     // Shader and resource binding
     CShaderModule::Ref CreateShaderModule(size_t size, const void* pCode);
+    // Push descriptor layouts are rewritten into the command buffer on every change, meant for
+    //   small sets that change every draw. Silently ignored if the device can't do it
     CDescriptorSetLayout::Ref
-    CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings);
+    CreateDescriptorSetLayout(const std::vector<CDescriptorSetLayoutBinding>& bindings,
+                              bool bPushDescriptors = false);
     CPipelineLayout::Ref
-    CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts);
+    CreatePipelineLayout(const std::vector<CDescriptorSetLayout::Ref>& setLayouts,
+                         const std::vector<CPushConstantRange>& pushConstantRanges = {});
+    // Created on first use, throws if the device can't do descriptor indexing
+    CBindlessHeap::Ref GetBindlessHeap();
 
     // States
     CRenderPass::Ref CreateRenderPass(const CRenderPassDesc& desc);
@@ -63,6 +94,19 @@ public:
 
     // Command submission
     CCommandQueue::Ref CreateCommandQueue();
+    // A new queue of the given type, successive calls are spread across the hardware queues
+    CCommandQueue::Ref CreateCommandQueue(EQueueType queueType);
+    CQueueCaps GetQueueCaps(EQueueType queueType) const;
+
+    CDescriptorStats GetDescriptorStats() const;
+    CConstantMemoryStats GetConstantMemoryStats() const;
+    // Walks every allocation, meant for a stats overlay or a periodic log rather than per draw
+    CMemoryStats GetMemoryStats() const;
+    // Moves allocations closer together to give empty blocks back, up to the limits in options.
+    //   Waits for the GPU, so run it between frames: lists recorded but not yet submitted still
+    //   point at the old places, and render bundles recorded before have to be recorded again.
+    //   Requires CDeviceCreateOptions::bEnableDefragmentation
+    CDefragmentStats Defragment(const CDefragmentOptions& options = CDefragmentOptions());
 
     // Windowing system interface
     CSwapChain::Ref CreateSwapChain(const CPresentationSurfaceDesc& info, EFormat format);
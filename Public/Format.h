@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 
 namespace RHI
 {
@@ -197,4 +199,144 @@ enum class EFormat
     ASTC_12x12_SRGB_BLOCK = 184,
 };
 
+enum class EFormatAspect : uint8_t
+{
+    None = 0,
+    Color = 1,
+    Depth = 2,
+    Stencil = 4,
+    DepthStencil = Depth | Stencil,
+};
+
+// Layout of a format in memory. Uncompressed formats are 1x1 blocks of one texel
+struct CFormatInfo
+{
+    uint8_t BlockWidth = 1;
+    uint8_t BlockHeight = 1;
+    uint8_t BytesPerBlock = 0;
+    EFormatAspect Aspect = EFormatAspect::None;
+
+    constexpr bool IsCompressed() const { return BlockWidth > 1 || BlockHeight > 1; }
+
+    // Bytes per row of blocks for a tightly packed image `width` texels wide
+    constexpr size_t GetRowPitch(uint32_t width) const
+    {
+        return size_t((width + BlockWidth - 1) / BlockWidth) * BytesPerBlock;
+    }
+
+    constexpr size_t GetSliceSize(uint32_t width, uint32_t height) const
+    {
+        return GetRowPitch(width) * ((height + BlockHeight - 1) / BlockHeight);
+    }
+
+    constexpr size_t GetImageSize(uint32_t width, uint32_t height, uint32_t depth) const
+    {
+        return GetSliceSize(width, height) * depth;
+    }
+
+    // Size of mip level `mip` of an image whose top level is width x height x depth
+    constexpr size_t GetMipSize(uint32_t width, uint32_t height, uint32_t depth,
+                                uint32_t mip) const
+    {
+        auto dim = [mip](uint32_t v) { return (v >> mip) > 0 ? v >> mip : 1u; };
+        return GetImageSize(dim(width), dim(height), dim(depth));
+    }
+};
+
+namespace FormatDetail
+{
+
+constexpr size_t FormatCount = static_cast<size_t>(EFormat::ASTC_12x12_SRGB_BLOCK) + 1;
+
+struct CFormatInfoTable
+{
+    CFormatInfo Infos[FormatCount];
+
+    // Fills first through last inclusive, relying on EFormat following Vulkan's ordering
+    constexpr void Set(EFormat first, EFormat last, uint8_t bytes,
+                       EFormatAspect aspect = EFormatAspect::Color)
+    {
+        for (auto i = static_cast<size_t>(first); i <= static_cast<size_t>(last); i++)
+            Infos[i] = { 1, 1, bytes, aspect };
+    }
+
+    constexpr void SetBlock(EFormat first, EFormat last, uint8_t w, uint8_t h, uint8_t bytes)
+    {
+        for (auto i = static_cast<size_t>(first); i <= static_cast<size_t>(last); i++)
+            Infos[i] = { w, h, bytes, EFormatAspect::Color };
+    }
+};
+
+constexpr CFormatInfoTable MakeFormatInfoTable()
+{
+    CFormatInfoTable t = {};
+    t.Set(EFormat::R4G4_UNORM_PACK8, EFormat::R4G4_UNORM_PACK8, 1);
+    t.Set(EFormat::R4G4B4A4_UNORM_PACK16, EFormat::A1R5G5B5_UNORM_PACK16, 2);
+    t.Set(EFormat::R8_UNORM, EFormat::R8_SRGB, 1);
+    t.Set(EFormat::R8G8_UNORM, EFormat::R8G8_SRGB, 2);
+    t.Set(EFormat::R8G8B8_UNORM, EFormat::B8G8R8_SRGB, 3);
+    t.Set(EFormat::R8G8B8A8_UNORM, EFormat::A2B10G10R10_SINT_PACK32, 4);
+    t.Set(EFormat::R16_UNORM, EFormat::R16_SFLOAT, 2);
+    t.Set(EFormat::R16G16_UNORM, EFormat::R16G16_SFLOAT, 4);
+    t.Set(EFormat::R16G16B16_UNORM, EFormat::R16G16B16_SFLOAT, 6);
+    t.Set(EFormat::R16G16B16A16_UNORM, EFormat::R16G16B16A16_SFLOAT, 8);
+    t.Set(EFormat::R32_UINT, EFormat::R32_SFLOAT, 4);
+    t.Set(EFormat::R32G32_UINT, EFormat::R32G32_SFLOAT, 8);
+    t.Set(EFormat::R32G32B32_UINT, EFormat::R32G32B32_SFLOAT, 12);
+    t.Set(EFormat::R32G32B32A32_UINT, EFormat::R32G32B32A32_SFLOAT, 16);
+    t.Set(EFormat::R64_UINT, EFormat::R64_SFLOAT, 8);
+    t.Set(EFormat::R64G64_UINT, EFormat::R64G64_SFLOAT, 16);
+    t.Set(EFormat::R64G64B64_UINT, EFormat::R64G64B64_SFLOAT, 24);
+    t.Set(EFormat::R64G64B64A64_UINT, EFormat::R64G64B64A64_SFLOAT, 32);
+    t.Set(EFormat::B10G11R11_UFLOAT_PACK32, EFormat::E5B9G9R9_UFLOAT_PACK32, 4);
+    t.Set(EFormat::D16_UNORM, EFormat::D16_UNORM, 2, EFormatAspect::Depth);
+    t.Set(EFormat::X8_D24_UNORM_PACK32, EFormat::D32_SFLOAT, 4, EFormatAspect::Depth);
+    t.Set(EFormat::S8_UINT, EFormat::S8_UINT, 1, EFormatAspect::Stencil);
+    t.Set(EFormat::D16_UNORM_S8_UINT, EFormat::D16_UNORM_S8_UINT, 3, EFormatAspect::DepthStencil);
+    t.Set(EFormat::D24_UNORM_S8_UINT, EFormat::D24_UNORM_S8_UINT, 4, EFormatAspect::DepthStencil);
+    t.Set(EFormat::D32_SFLOAT_S8_UINT, EFormat::D32_SFLOAT_S8_UINT, 5,
+          EFormatAspect::DepthStencil);
+    t.SetBlock(EFormat::BC1_RGB_UNORM_BLOCK, EFormat::BC1_RGBA_SRGB_BLOCK, 4, 4, 8);
+    t.SetBlock(EFormat::BC2_UNORM_BLOCK, EFormat::BC3_SRGB_BLOCK, 4, 4, 16);
+    t.SetBlock(EFormat::BC4_UNORM_BLOCK, EFormat::BC4_SNORM_BLOCK, 4, 4, 8);
+    t.SetBlock(EFormat::BC5_UNORM_BLOCK, EFormat::BC7_SRGB_BLOCK, 4, 4, 16);
+    t.SetBlock(EFormat::ETC2_R8G8B8_UNORM_BLOCK, EFormat::ETC2_R8G8B8A1_SRGB_BLOCK, 4, 4, 8);
+    t.SetBlock(EFormat::ETC2_R8G8B8A8_UNORM_BLOCK, EFormat::ETC2_R8G8B8A8_SRGB_BLOCK, 4, 4, 16);
+    t.SetBlock(EFormat::EAC_R11_UNORM_BLOCK, EFormat::EAC_R11_SNORM_BLOCK, 4, 4, 8);
+    t.SetBlock(EFormat::EAC_R11G11_UNORM_BLOCK, EFormat::EAC_R11G11_SNORM_BLOCK, 4, 4, 16);
+    t.SetBlock(EFormat::ASTC_4x4_UNORM_BLOCK, EFormat::ASTC_4x4_SRGB_BLOCK, 4, 4, 16);
+    t.SetBlock(EFormat::ASTC_5x4_UNORM_BLOCK, EFormat::ASTC_5x4_SRGB_BLOCK, 5, 4, 16);
+    t.SetBlock(EFormat::ASTC_5x5_UNORM_BLOCK, EFormat::ASTC_5x5_SRGB_BLOCK, 5, 5, 16);
+    t.SetBlock(EFormat::ASTC_6x5_UNORM_BLOCK, EFormat::ASTC_6x5_SRGB_BLOCK, 6, 5, 16);
+    t.SetBlock(EFormat::ASTC_6x6_UNORM_BLOCK, EFormat::ASTC_6x6_SRGB_BLOCK, 6, 6, 16);
+    t.SetBlock(EFormat::ASTC_8x5_UNORM_BLOCK, EFormat::ASTC_8x5_SRGB_BLOCK, 8, 5, 16);
+    t.SetBlock(EFormat::ASTC_8x6_UNORM_BLOCK, EFormat::ASTC_8x6_SRGB_BLOCK, 8, 6, 16);
+    t.SetBlock(EFormat::ASTC_8x8_UNORM_BLOCK, EFormat::ASTC_8x8_SRGB_BLOCK, 8, 8, 16);
+    t.SetBlock(EFormat::ASTC_10x5_UNORM_BLOCK, EFormat::ASTC_10x5_SRGB_BLOCK, 10, 5, 16);
+    t.SetBlock(EFormat::ASTC_10x6_UNORM_BLOCK, EFormat::ASTC_10x6_SRGB_BLOCK, 10, 6, 16);
+    t.SetBlock(EFormat::ASTC_10x8_UNORM_BLOCK, EFormat::ASTC_10x8_SRGB_BLOCK, 10, 8, 16);
+    t.SetBlock(EFormat::ASTC_10x10_UNORM_BLOCK, EFormat::ASTC_10x10_SRGB_BLOCK, 10, 10, 16);
+    t.SetBlock(EFormat::ASTC_12x10_UNORM_BLOCK, EFormat::ASTC_12x10_SRGB_BLOCK, 12, 10, 16);
+    t.SetBlock(EFormat::ASTC_12x12_UNORM_BLOCK, EFormat::ASTC_12x12_SRGB_BLOCK, 12, 12, 16);
+    return t;
+}
+
+inline constexpr CFormatInfoTable FormatInfoTable = MakeFormatInfoTable();
+
+} /* namespace FormatDetail */
+
+// UNDEFINED and anything out of range come back with BytesPerBlock == 0
+constexpr CFormatInfo GetFormatInfo(EFormat format)
+{
+    auto index = static_cast<size_t>(format);
+    return index < FormatDetail::FormatCount ? FormatDetail::FormatInfoTable.Infos[index]
+                                             : CFormatInfo {};
+}
+
+static_assert(GetFormatInfo(EFormat::R8G8B8A8_UNORM).BytesPerBlock == 4, "Bad format table");
+static_assert(GetFormatInfo(EFormat::BC1_RGBA_UNORM_BLOCK).GetImageSize(6, 6, 1) == 32,
+              "Bad format table");
+static_assert(GetFormatInfo(EFormat::BC7_SRGB_BLOCK).GetMipSize(256, 256, 1, 8) == 16,
+              "Bad format table");
+
 } /* namespace RHI */
@@ -16,11 +16,16 @@ class CManagedPipeline
 public:
     typedef std::shared_ptr<CManagedPipeline> Ref;
 
+    // By convention the set that changes every draw, it's pushed with VK_KHR_push_descriptor
+    //   when small. A fixed index keeps every pipeline agreeing on which layouts push
+    static const uint32_t PushDescriptorSet = 3;
+
     CManagedPipeline(CDevice& device, CPipelineDesc& desc);
     CManagedPipeline(CDevice& device, CComputePipelineDesc& desc);
 
     CPipeline::Ref Get() const { return Pipeline; }
 
+    // Sets with unbounded arrays are the device's bindless heap, its descriptor set is returned
     CDescriptorSet::Ref CreateDescriptorSet(uint32_t set) const;
     std::vector<CDescriptorSet::Ref> CreateDescriptorSets() const;
 
@@ -30,8 +35,11 @@ private:
 
     // Reflection data
     std::map<std::pair<uint32_t, uint32_t>, CPipelineResource> ResourceByBinding;
+    // Push constant blocks of all stages merged into one range, Size == 0 if there is none
+    CPushConstantRange PushConstants {};
 
     std::vector<CDescriptorSetLayout::Ref> SetLayouts;
+    CBindlessHeap::Ref BindlessHeap;
     CPipelineLayout::Ref PipelineLayout;
     CPipeline::Ref Pipeline;
 };
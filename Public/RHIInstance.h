@@ -14,7 +14,8 @@ public:
     CDevice::Ref GetCurrDevice() const;
     void SetCurrDevice(CDevice::Ref device);
 
-    CDevice::Ref CreateDevice(EDeviceCreateHints hints);
+    CDevice::Ref CreateDevice(EDeviceCreateHints hints,
+                              const CDeviceCreateOptions& options = {});
 
 private:
     CInstance();
@@ -4,6 +4,29 @@
 namespace RHI
 {
 
+// One draw for IRenderContext::SubmitDrawBatch, null pointers keep whatever is currently bound
+struct CDrawRecord
+{
+    static const uint32_t MaxDescriptorSets = 4;
+    static const uint32_t MaxVertexBuffers = 4;
+
+    CPipeline* Pipeline = nullptr;
+    CDescriptorSet* DescriptorSets[MaxDescriptorSets] = {};
+    CBuffer* VertexBuffers[MaxVertexBuffers] = {};
+    size_t VertexOffsets[MaxVertexBuffers] = {};
+    CBuffer* IndexBuffer = nullptr;
+    size_t IndexOffset = 0;
+    EFormat IndexFormat = EFormat::R16_UINT;
+
+    // Draw parameters, VertexOffset is only used by indexed draws
+    bool bIndexed = false;
+    uint32_t Count = 0;
+    uint32_t InstanceCount = 1;
+    uint32_t First = 0;
+    int32_t VertexOffset = 0;
+    uint32_t FirstInstance = 0;
+};
+
 class IRenderContext
 {
 public:
@@ -17,6 +40,8 @@ public:
     virtual void SetBlendConstants(const std::array<float, 4>& blendConstants) = 0;
     virtual void SetStencilReference(uint32_t reference) = 0;
     virtual void BindRenderDescriptorSet(uint32_t set, CDescriptorSet& descriptorSet) = 0;
+    // Writes into the push constant block of the bound pipeline's layout
+    virtual void PushConstants(uint32_t offset, uint32_t size, const void* data) = 0;
     virtual void BindIndexBuffer(CBuffer& buffer, size_t offset, EFormat format) = 0;
     virtual void BindVertexBuffer(uint32_t binding, CBuffer& buffer, size_t offset) = 0;
     virtual void Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex,
@@ -26,10 +51,25 @@ public:
                              uint32_t firstInstance) = 0;
     virtual void DrawIndirect(CBuffer& buffer, size_t offset, uint32_t drawCount, uint32_t stride) = 0;
     virtual void DrawIndexedIndirect(CBuffer& buffer, size_t offset, uint32_t drawCount, uint32_t stride) = 0;
+    // Binds and draws each record in order, skipping redundant state changes
+    virtual void SubmitDrawBatch(const CDrawRecord* records, size_t count) = 0;
 
     virtual void FinishRecording() = 0;
 };
 
+// Render commands recorded once and executed in many render passes
+//   Everything a bundle references must stay alive while the bundle is in use. A descriptor set
+//   is captured at the first draw after it's bound and may be changed afterwards, but constants
+//   and swapchain images only live for a frame, so recording them into a bundle throws
+class CRenderBundle
+{
+public:
+    typedef std::shared_ptr<CRenderBundle> Ref;
+    virtual ~CRenderBundle() = default;
+    // Can be called only once, FinishRecording on the returned context seals the bundle
+    virtual IRenderContext::Ref CreateRenderContext() = 0;
+};
+
 // A meta context from which you can create multiple render contexts for a render pass
 class IParallelRenderContext
 {
@@ -37,6 +77,8 @@ public:
     typedef std::shared_ptr<IParallelRenderContext> Ref;
     virtual ~IParallelRenderContext() = default;
     virtual IRenderContext::Ref CreateRenderContext(uint32_t subpass) = 0;
+    // The bundle must be recorded for a compatible render pass and the same subpass
+    virtual void ExecuteBundle(uint32_t subpass, CRenderBundle::Ref bundle) = 0;
     virtual void FinishRecording() = 0;
 };
 
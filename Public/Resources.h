@@ -5,6 +5,7 @@
 #include <LangUtils.h>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace RHI
 {
@@ -42,14 +43,30 @@ public:
 
     virtual ~CBufferBase() = default;
 
+    size_t GetSize() const { return Size; }
+
+    // Dynamic, Upload and Readback buffers stay mapped, so Map is cheap and the pointer stays
+    //   valid until the buffer dies. Map pulls in GPU writes for Readback buffers and Unmap pushes
+    //   out CPU writes for the others
     void* Map(size_t offset, size_t size);
     void Unmap();
+    // For writes and reads through a pointer kept past Unmap, a no-op on coherent memory
+    void FlushRange(size_t offset, size_t size);
+    void InvalidateRange(size_t offset, size_t size);
 
 protected:
     size_t Size;
     EBufferUsageFlags Usage;
 };
 
+// A slice of a frame's transient memory, see CDevice::AllocateTransient
+struct CTransientAllocation
+{
+    CBuffer::Ref Buffer;
+    size_t Offset = 0;
+    void* Data = nullptr;
+};
+
 class CBufferView : public tc::FNonCopyable
 {
 public:
@@ -191,4 +208,86 @@ public:
     virtual ~CImageView() = default;
 };
 
+// Initial data uploads, running totals since the device was created
+struct CUploadStats
+{
+    uint64_t Uploads = 0;
+    uint64_t Batches = 0;
+    uint64_t Bytes = 0;
+    // Measured from submission until the batch is seen complete, so it errs on the low side
+    double MegabytesPerSecond = 0.0;
+};
+
+// What the RHI allocates device memory for
+enum class EMemoryCategory : uint32_t
+{
+    Buffers,
+    Images,
+    // Images with RenderTarget or DepthStencil usage
+    RenderTargets,
+    // Upload and Readback buffers, staging images and the upload ring
+    Staging,
+    ConstantRing,
+    TransientRing,
+    Count
+};
+
+struct CMemoryCategoryStats
+{
+    uint64_t Allocations = 0;
+    uint64_t Bytes = 0;
+};
+
+struct CMemoryHeapStats
+{
+    uint64_t Size = 0;
+    bool bDeviceLocal = false;
+    // How much the OS lets this process use and how much the process uses, including other
+    //   APIs. Without VK_EXT_memory_budget, Budget is Size and Usage is BlockBytes
+    uint64_t Budget = 0;
+    uint64_t Usage = 0;
+    // Memory blocks the RHI holds in this heap, and the part of them handed out
+    uint64_t BlockBytes = 0;
+    uint64_t AllocatedBytes = 0;
+};
+
+struct CMemoryStats
+{
+    std::vector<CMemoryHeapStats> Heaps;
+    CMemoryCategoryStats Categories[static_cast<size_t>(EMemoryCategory::Count)];
+
+    uint32_t BlockCount = 0;
+    uint32_t AllocationCount = 0;
+    // Free space within the blocks, and how it's split up
+    uint64_t UnusedBytes = 0;
+    uint32_t UnusedRangeCount = 0;
+    uint64_t LargestUnusedRange = 0;
+    // 0 when the free space is one range, approaching 1 as it scatters into small ones
+    float Fragmentation = 0.0f;
+
+    const CMemoryCategoryStats& operator[](EMemoryCategory category) const
+    {
+        return Categories[static_cast<size_t>(category)];
+    }
+};
+
+// How much one Defragment call may move, small enough limits let it run a step every frame
+struct CDefragmentOptions
+{
+    uint64_t MaxBytesToMove = 16 * 1024 * 1024;
+    uint32_t MaxAllocationsToMove = 64;
+};
+
+struct CDefragmentStats
+{
+    uint64_t BytesMoved = 0;
+    // Given back to the driver as blocks emptied out
+    uint64_t BytesFreed = 0;
+    uint32_t AllocationsMoved = 0;
+    uint32_t BlocksFreed = 0;
+    // CMemoryStats::Fragmentation around the step
+    float FragmentationBefore = 0.0f;
+    float FragmentationAfter = 0.0f;
+};
+
 } /* namespace RHI */
@@ -46,7 +46,7 @@ struct CSamplerDesc
     float MaxLod = FLT_MAX;
     std::array<float, 4> BorderColor = { 1.0f, 1.0f, 1.0f, 1.0f };
 
-    bool operator=(const CSamplerDesc& r) const
+    bool operator==(const CSamplerDesc& r) const
     {
         return MagFilter == r.MagFilter && MinFilter == r.MinFilter && MipmapMode == r.MipmapMode
             && AddressModeU == r.AddressModeU && AddressModeV == r.AddressModeV
@@ -0,0 +1,131 @@
+// Hammers CPersistentMappedRingBuffer::Allocate from several threads while the main thread ends
+//   and frees blocks underneath them, the way SubmitFrame does. Every allocation is stamped and
+//   read back, so two threads handed overlapping memory show up as a mismatch
+#include "RHIInstance.h"
+#include "Vulkan/DeviceVk.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace RHI;
+
+namespace
+{
+
+constexpr uint32_t ThreadCount = 8;
+constexpr uint64_t FrameCount = 2000;
+// Blocks kept before the oldest is freed, like frames in flight
+constexpr uint64_t BlocksInFlight = 3;
+
+std::atomic<uint64_t> CurrFrame { 0 };
+std::atomic<bool> bStop { false };
+std::atomic<uint64_t> Failures { 0 };
+std::atomic<uint64_t> Allocations { 0 };
+// The frame each worker saw before its current allocation, no block from before it is touched
+std::atomic<uint64_t> WorkerFrames[ThreadCount];
+
+void Fail(const char* what, uint32_t threadIndex)
+{
+    if (Failures++ < 16)
+        printf("thread %u: %s\n", threadIndex, what);
+}
+
+void Worker(CPersistentMappedRingBuffer* ring, uint32_t threadIndex)
+{
+    uint32_t seed = threadIndex * 7919 + 1;
+    uint32_t counter = 0;
+    while (!bStop)
+    {
+        WorkerFrames[threadIndex] = CurrFrame.load();
+
+        // Mostly small constants, now and then one that gets a chunk or a page of its own
+        seed = seed * 1664525 + 1013904223;
+        size_t size = 16 + (seed >> 8) % 1024;
+        if (seed % 64 == 0)
+            size = 96 * 1024;
+        if (seed % 4096 == 0)
+            size = 3 * 1024 * 1024;
+        size_t alignment = size_t(16) << ((seed >> 28) % 5);
+
+        CBufferVk::Ref buffer;
+        size_t offset;
+        auto* data = static_cast<uint32_t*>(ring->Allocate(size, alignment, buffer, offset));
+        if (!data)
+        {
+            Fail("allocation failed", threadIndex);
+            continue;
+        }
+        if (offset % alignment != 0 || offset + size > buffer->GetSize())
+            Fail("allocation is misaligned or out of bounds", threadIndex);
+
+        uint32_t stamp = (threadIndex << 24) ^ ++counter;
+        size_t words = size / sizeof(uint32_t);
+        for (size_t i = 0; i < words; i++)
+            data[i] = stamp;
+        std::this_thread::yield();
+        for (size_t i = 0; i < words; i++)
+            if (data[i] != stamp)
+            {
+                Fail("allocation overlaps another", threadIndex);
+                break;
+            }
+        Allocations++;
+    }
+    WorkerFrames[threadIndex] = UINT64_MAX;
+}
+
+}
+
+int main()
+{
+    auto device = std::static_pointer_cast<CDeviceVk>(
+        CInstance::Get().CreateDevice(EDeviceCreateHints::NoHint));
+    auto* ring = device->GetHugeConstantBuffer();
+
+    for (auto& frame : WorkerFrames)
+        frame = 0;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < ThreadCount; i++)
+        threads.emplace_back(Worker, ring, i);
+
+    uint64_t freedBlocks = 0;
+    auto freeSafeBlocks = [&](uint64_t keep) {
+        while (CurrFrame.load() - freedBlocks > keep)
+        {
+            // A worker that saw an older frame may still be writing into the oldest block
+            bool bSafe = true;
+            for (const auto& frame : WorkerFrames)
+                bSafe &= frame.load() > freedBlocks;
+            if (!bSafe)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            ring->FreeBlock();
+            freedBlocks++;
+        }
+    };
+
+    for (uint64_t frame = 0; frame < FrameCount; frame++)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        ring->MarkBlockEnd();
+        CurrFrame = frame + 1;
+        freeSafeBlocks(BlocksInFlight);
+    }
+
+    bStop = true;
+    for (auto& thread : threads)
+        thread.join();
+    ring->MarkBlockEnd();
+    CurrFrame++;
+    freeSafeBlocks(0);
+
+    printf("%llu allocations over %llu frames, %llu failures\n",
+           static_cast<unsigned long long>(Allocations.load()),
+           static_cast<unsigned long long>(FrameCount),
+           static_cast<unsigned long long>(Failures.load()));
+    return Failures.load() == 0 ? 0 : 1;
+}